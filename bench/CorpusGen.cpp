@@ -0,0 +1,412 @@
+// synthetic traffic corpus for benchmarks, binary archive (as for -b) to
+// stdout:
+//   make bench && ./dnsrrparser_corpus 1000000 0.02 > corpus.bin
+// arguments: messages [malformed ratio] [TCP-sized ratio] [seed]
+//
+// queries and responses of mixed types, names of many labels sharing zones
+// (compression pointers lead to other pointers), some large answer sections
+// and some messages close to 64K. Malformed messages are mutated valid ones,
+// every one of them is rejected by CheckDnsMessage
+#include "MessageParser.h"
+#include "dns_constants.h"
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const uint16_t TYPE_OPT = 41;
+const uint16_t TYPE_HTTPS = 65;
+const size_t TCP_SIZE_LIMIT = 65000;
+// archive frame has 2-byte length
+const size_t FRAME_SIZE_LIMIT = 0xffff;
+
+// wire format with name compression: every suffix of a written name could
+// be pointed to later
+class MessageWriter {
+public:
+  void Clear() {
+    m_out.clear();
+    m_suffixes.clear();
+  }
+
+  // takes back everything after size, names there aren't pointed to anymore
+  void Truncate(size_t size) {
+    m_out.resize(size);
+    for (auto it = m_suffixes.begin(); it != m_suffixes.end();)
+      it = (it->second >= size) ? m_suffixes.erase(it) : std::next(it);
+  }
+
+  void U8(uint8_t value) { m_out.push_back(value); }
+  void U16(uint16_t value) {
+    m_out.push_back(value >> 8);
+    m_out.push_back(value & 0xff);
+  }
+  void U32(uint32_t value) {
+    U16(value >> 16);
+    U16(value & 0xffff);
+  }
+  void Bytes(const std::string &value) {
+    m_out.insert(m_out.end(), value.begin(), value.end());
+  }
+  void Patch16(size_t offset, uint16_t value) {
+    m_out[offset] = value >> 8;
+    m_out[offset + 1] = value & 0xff;
+  }
+
+  // dotted name without trailing dot, "" is root
+  void Name(const std::string &name, bool compress = true) {
+    size_t start = 0;
+    while (start < name.size()) {
+      std::string suffix = lowercase(name.substr(start));
+      auto found = m_suffixes.find(suffix);
+      if (compress && found != m_suffixes.end()) {
+        U16(0xC000 | found->second);
+        return;
+      }
+      if (m_out.size() < 0x3fff)
+        m_suffixes.emplace(suffix, m_out.size());
+      size_t end = name.find('.', start);
+      if (end == std::string::npos)
+        end = name.size();
+      U8(end - start);
+      m_out.insert(m_out.end(), name.begin() + start, name.begin() + end);
+      start = end + 1;
+    }
+    U8(0);
+  }
+
+  std::vector<uint8_t> &Data() { return m_out; }
+  size_t Size() const { return m_out.size(); }
+
+private:
+  static std::string lowercase(std::string name) {
+    for (char &c : name)
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+    return name;
+  }
+
+  std::vector<uint8_t> m_out;
+  std::unordered_map<std::string, uint16_t> m_suffixes;
+};
+
+class CorpusGenerator {
+public:
+  CorpusGenerator(double malformedRatio, double tcpRatio, uint32_t seed)
+      : m_malformedRatio(malformedRatio), m_tcpRatio(tcpRatio),
+        m_random(seed) {}
+
+  // next message, true if it's valid
+  bool Next(std::vector<uint8_t> &message) {
+    if (Chance(0.3))
+      Query();
+    else
+      Response();
+    message = m_writer.Data();
+    if (!Chance(m_malformedRatio))
+      return true;
+    Corrupt(message);
+    return false;
+  }
+
+private:
+  bool Chance(double probability) {
+    return std::uniform_real_distribution<double>(0, 1)(m_random) <
+           probability;
+  }
+  size_t Uniform(size_t from, size_t to) {
+    return std::uniform_int_distribution<size_t>(from, to)(m_random);
+  }
+  template <typename T, size_t N> const T &Pick(const T (&values)[N]) {
+    return values[Uniform(0, N - 1)];
+  }
+
+  std::string Zone() {
+    static const char *words[] = {"example", "rbc",   "youtube", "vk",
+                                  "samba",   "cloud", "shop",    "news",
+                                  "bank",    "mail",  "video",   "game"};
+    static const char *tlds[] = {"com", "ru", "net", "org", "co.uk", "io"};
+    // small set of zones: names of a message share suffixes
+    return std::string(Pick(words)) + std::to_string(Uniform(0, 50)) + "." +
+           Pick(tlds);
+  }
+
+  // up to 10 labels under zone, now and then 0x20-randomized case
+  std::string Subdomain(const std::string &zone, size_t maxDepth = 4) {
+    static const char *labels[] = {"www", "mail", "api",  "cdn", "static",
+                                   "img", "edge", "auth", "eu",  "us",
+                                   "dev", "app",  "_tcp", "_sip"};
+    std::string name = zone;
+    size_t depth = Uniform(0, maxDepth);
+    for (size_t i = 0; i < depth; i++) {
+      std::string label = Pick(labels);
+      if (Chance(0.1))
+        label += std::to_string(Uniform(0, 999));
+      name = label + "." + name;
+    }
+    if (Chance(0.05)) {
+      for (char &c : name)
+        if (c >= 'a' && c <= 'z' && Chance(0.5))
+          c += 'A' - 'a';
+    }
+    return name;
+  }
+
+  std::string Text(size_t length) {
+    std::string ret;
+    for (size_t i = 0; i < length; i++)
+      ret += (char)Uniform(' ', '~');
+    return ret;
+  }
+
+  uint16_t RecordType() {
+    static const uint16_t weighted[] = {
+        TYPE_A,  TYPE_A,   TYPE_A,     TYPE_A,     TYPE_A,    TYPE_A,
+        TYPE_A,  TYPE_AAAA, TYPE_AAAA, TYPE_AAAA,  TYPE_AAAA, TYPE_CNAME,
+        TYPE_CNAME, TYPE_NS, TYPE_NS,  TYPE_MX,    TYPE_TXT,  TYPE_TXT,
+        TYPE_SOA, TYPE_SRV, TYPE_PTR,  TYPE_HTTPS};
+    return Pick(weighted);
+  }
+
+  void Header(bool response, uint16_t qdcount) {
+    m_writer.Clear();
+    m_writer.U16(Uniform(0, 0xffff));
+    uint16_t flags = 0x0100; // RD
+    if (response)
+      flags |= 0x8000 | 0x0080 | (Chance(0.05) ? 3 : 0); // RA, NXDOMAIN
+    m_writer.U16(flags);
+    m_writer.U16(qdcount);
+    m_writer.U16(0);
+    m_writer.U16(0);
+    m_writer.U16(0);
+  }
+
+  void Opt() {
+    m_writer.Name("");
+    m_writer.U16(TYPE_OPT);
+    m_writer.U16(1232); // UDP payload size
+    m_writer.U32(0);
+    m_writer.U16(0);
+  }
+
+  void Record(const std::string &owner, uint16_t type, const std::string &zone,
+              size_t txtLength) {
+    m_writer.Name(owner);
+    m_writer.U16(type);
+    m_writer.U16(1);
+    m_writer.U32(Uniform(0, 86400));
+    size_t lengthOffset = m_writer.Size();
+    m_writer.U16(0);
+    switch (type) {
+    case TYPE_A:
+      m_writer.U32(Uniform(0, 0xffffffff));
+      break;
+    case TYPE_AAAA:
+      for (int i = 0; i < 4; i++)
+        m_writer.U32(Uniform(0, 0xffffffff));
+      break;
+    case TYPE_CNAME:
+    case TYPE_NS:
+    case TYPE_PTR:
+      m_writer.Name(Subdomain(zone));
+      break;
+    case TYPE_MX:
+      m_writer.U16(Uniform(0, 50));
+      m_writer.Name(Subdomain(zone));
+      break;
+    case TYPE_TXT:
+      for (size_t left = txtLength; left;) {
+        size_t length = std::min<size_t>(left, 255);
+        m_writer.U8(length);
+        m_writer.Bytes(Text(length));
+        left -= length;
+      }
+      break;
+    case TYPE_SOA:
+      m_writer.Name("ns1." + zone);
+      m_writer.Name("hostmaster." + zone);
+      for (int i = 0; i < 5; i++)
+        m_writer.U32(Uniform(0, 0xffffffff));
+      break;
+    case TYPE_SRV:
+      m_writer.U16(Uniform(0, 10));
+      m_writer.U16(Uniform(0, 100));
+      m_writer.U16(Uniform(1, 0xffff));
+      // rfc-2782: target isn't compressed
+      m_writer.Name(Subdomain(zone), false);
+      break;
+    default:
+      m_writer.Bytes(Text(Uniform(4, 40)));
+      break;
+    }
+    m_writer.Patch16(lengthOffset, m_writer.Size() - lengthOffset - 2);
+  }
+
+  void Query() {
+    Header(false, 1);
+    m_writer.Name(Subdomain(Zone(), 6));
+    m_writer.U16(RecordType());
+    m_writer.U16(1);
+    if (Chance(0.7)) {
+      Opt();
+      m_writer.Patch16(10, 1);
+    }
+  }
+
+  // false if message grew over limit since mark: it's cut back to mark
+  bool Fits(size_t mark, size_t limit) {
+    if (m_writer.Size() <= limit)
+      return true;
+    m_writer.Truncate(mark);
+    return false;
+  }
+
+  void Response() {
+    std::string zone = Zone();
+    std::string qname = Subdomain(zone, 6);
+    uint16_t qtype = RecordType();
+    Header(true, 1);
+    m_writer.Name(qname);
+    m_writer.U16(qtype);
+    m_writer.U16(1);
+
+    // mostly a few records, sometimes large sections, rarely TCP-sized
+    bool tcp = Chance(m_tcpRatio);
+    size_t answers = Uniform(1, 4);
+    if (tcp)
+      answers = 0xffff;
+    else if (Chance(0.2))
+      answers = Uniform(5, 20);
+    else if (Chance(0.05))
+      answers = Uniform(20, 150);
+    size_t limit = tcp ? TCP_SIZE_LIMIT : FRAME_SIZE_LIMIT;
+
+    // answers leave some room for authority and additional, but the limit is
+    // kept by Fits: a record crossing it is taken back
+    uint16_t counts[3] = {0, 0, 0};
+    std::string owner = qname;
+    for (size_t i = 0; i < answers && m_writer.Size() + 600 < limit; i++) {
+      size_t mark = m_writer.Size();
+      uint16_t type = (i == 0 || Chance(0.3)) ? qtype : RecordType();
+      Record(owner, type, zone, tcp ? Uniform(1, 700) : Uniform(1, 120));
+      if (!Fits(mark, limit))
+        break;
+      counts[0]++;
+      // CNAME chain or records of neighbours
+      if (type == TYPE_CNAME || Chance(0.2))
+        owner = Subdomain(zone, 8);
+    }
+    if (Chance(0.3)) {
+      for (size_t i = Uniform(1, 4); i; i--, counts[1]++) {
+        size_t mark = m_writer.Size();
+        Record(zone, Chance(0.8) ? TYPE_NS : TYPE_SOA, zone, 0);
+        if (!Fits(mark, limit))
+          break;
+      }
+    }
+    if (Chance(0.3)) {
+      for (size_t i = Uniform(1, 6); i; i--, counts[2]++) {
+        size_t mark = m_writer.Size();
+        Record(Subdomain(zone, 2), Chance(0.7) ? TYPE_A : TYPE_AAAA, zone, 0);
+        if (!Fits(mark, limit))
+          break;
+      }
+    }
+    if (Chance(0.6)) {
+      size_t mark = m_writer.Size();
+      Opt();
+      if (Fits(mark, limit))
+        counts[2]++;
+    }
+    m_writer.Patch16(6, counts[0]);
+    m_writer.Patch16(8, counts[1]);
+    m_writer.Patch16(10, counts[2]);
+  }
+
+  void Mutate(std::vector<uint8_t> &message) {
+    switch (Uniform(0, 4)) {
+    case 0: // cut anywhere
+      message.resize(Uniform(0, message.size() - 1));
+      break;
+    case 1: // more records than there are
+      message[6] += Uniform(1, 200);
+      break;
+    case 2: // QNAME points to itself
+      message[12] = 0xC0;
+      message[13] = 12;
+      break;
+    case 3: // reserved label type
+      message[12] = 0x40 | message[12];
+      break;
+    default: // random bytes
+      for (size_t i = Uniform(1, 8); i; i--)
+        message[Uniform(0, message.size() - 1)] = Uniform(0, 0xff);
+      break;
+    }
+  }
+
+  void Corrupt(std::vector<uint8_t> &message) {
+    std::vector<uint8_t> original = message;
+    for (int attempt = 0; attempt < 16; attempt++) {
+      Mutate(message);
+      MessageParser checker(message.data(), message.size());
+      if (checker.CheckDnsMessage())
+        return;
+      message = original;
+    }
+    // header isn't complete
+    message.resize(Uniform(0, 11));
+  }
+
+  double m_malformedRatio;
+  double m_tcpRatio;
+  std::mt19937_64 m_random;
+  MessageWriter m_writer;
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0]
+              << " messages [malformed ratio] [TCP-sized ratio] [seed]"
+              << std::endl;
+    return 1;
+  }
+  size_t messages = std::stoul(argv[1]);
+  double malformedRatio = (argc > 2) ? std::stod(argv[2]) : 0.01;
+  double tcpRatio = (argc > 3) ? std::stod(argv[3]) : 0.001;
+  uint32_t seed = (argc > 4) ? std::stoul(argv[4]) : 1;
+
+  CorpusGenerator generator(malformedRatio, tcpRatio, seed);
+  std::vector<uint8_t> message;
+  std::vector<char> frame;
+  size_t malformed = 0;
+  size_t bytes = 0;
+  size_t largest = 0;
+  for (size_t i = 0; i < messages; i++) {
+    bool valid = generator.Next(message);
+    if (valid) {
+      // generator and parser should agree
+      MessageParser checker(message.data(), message.size());
+      if (const char *error = checker.CheckDnsMessage()) {
+        std::cerr << "generated invalid message: " << error << std::endl;
+        return 1;
+      }
+    }
+    if (message.size() > FRAME_SIZE_LIMIT) {
+      std::cerr << "generated message doesn't fit in a frame" << std::endl;
+      return 1;
+    }
+    malformed += !valid;
+    bytes += message.size();
+    largest = std::max(largest, message.size());
+
+    frame.assign({(char)(message.size() >> 8), (char)(message.size() & 0xff)});
+    frame.insert(frame.end(), message.begin(), message.end());
+    std::cout.write(frame.data(), frame.size());
+  }
+  std::cerr << messages << " messages, " << malformed << " malformed, "
+            << bytes << " bytes, largest " << largest << std::endl;
+  return 0;
+}
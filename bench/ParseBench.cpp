@@ -0,0 +1,196 @@
+// throughput of parsing well-formed and adversarial corpus, by
+// TryGetDnsMessageValue and by throwing GetDnsMessageValue:
+//   make bench && ./dnsrrparser_bench
+// exits with 1 if an adversarial message costs NOISE_MARGIN times more than
+// well-formed bytes of its size and rejection of an empty message cost on
+// the same path, i.e. someone lost a bound in the parser
+#include "MessageParser.h"
+#include "input.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct corpus_entry_t {
+  std::string name;
+  std::vector<uint8_t> message;
+};
+
+struct bench_result_t {
+  double nsPerMessage;
+  double nsPerByte;
+};
+
+static std::vector<corpus_entry_t> load(const std::vector<std::string> &names) {
+  std::vector<corpus_entry_t> ret;
+  for (const auto &it : names) {
+    std::ifstream istrm("inputs/" + it, std::ifstream::in);
+    if (!istrm)
+      throw std::invalid_argument("could not open inputs/" + it);
+    ret.push_back({it, get_raw_data(istrm)});
+  }
+  return ret;
+}
+
+// the VM or a neighbour could stall any single round: best of them is kept
+const size_t ROUNDS = 5;
+// adversarial message may cost this much more than its expected cost: long
+// pointer chains are ~1.5x per byte by themselves (127 hops per name), the
+// rest is noise of the best round. A lost bound costs orders of magnitude more
+const double NOISE_MARGIN = 2.5;
+
+static bool parse(const corpus_entry_t &entry, bool throwing) {
+  MessageParser mp(entry.message.data(), entry.message.size());
+  dns_message_value_t dm;
+  if (!throwing)
+    return mp.TryGetDnsMessageValue(dm);
+  try {
+    mp.GetDnsMessageValue(dm);
+    return true;
+  } catch (std::invalid_argument &e) {
+    return false;
+  }
+}
+
+static bench_result_t run(const corpus_entry_t &entry, size_t iterations,
+                          bool throwing) {
+  double best = 0;
+  for (size_t round = 0; round < ROUNDS; round++) {
+    size_t parsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+      parsed += parse(entry, throwing);
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    if (parsed != 0 && parsed != iterations)
+      throw std::logic_error("unstable result for " + entry.name);
+    if (round == 0 || ns < best)
+      best = ns;
+  }
+  double nsPerMessage = best / iterations;
+  return {nsPerMessage,
+          nsPerMessage / std::max<size_t>(entry.message.size(), 1)};
+}
+
+static void print(const corpus_entry_t &entry, const bench_result_t &r) {
+  std::cout << "  " << std::setw(28) << std::left << entry.name << std::right
+            << std::setw(6) << entry.message.size() << " bytes "
+            << std::setw(10) << std::fixed << std::setprecision(1)
+            << r.nsPerMessage << " ns/message " << std::setw(8)
+            << std::setprecision(2) << r.nsPerByte << " ns/byte";
+}
+
+// returns number of adversarial messages over their expected cost
+static size_t report(bool throwing, const std::vector<corpus_entry_t> &good,
+                     const std::vector<corpus_entry_t> &bad,
+                     size_t iterations) {
+  std::cout << (throwing ? "GetDnsMessageValue" : "TryGetDnsMessageValue")
+            << ", well-formed:" << std::endl;
+  double totalNs = 0;
+  size_t totalBytes = 0;
+  for (const auto &it : good) {
+    bench_result_t r = run(it, iterations, throwing);
+    totalNs += r.nsPerMessage;
+    totalBytes += it.message.size();
+    print(it, r);
+    std::cout << std::endl;
+  }
+  double nsPerByte = totalNs / totalBytes;
+  // fixed cost of a rejection: exception is the most of it when throwing
+  double rejectNs = run({"empty", {}}, iterations, throwing).nsPerMessage;
+  std::cout << "  total " << std::setprecision(2) << nsPerByte
+            << " ns/byte, rejection " << std::setprecision(1) << rejectNs
+            << " ns" << std::endl;
+
+  std::cout << "adversarial, bound " << std::setprecision(2) << NOISE_MARGIN
+            << "x of rejection + well-formed ns/byte:" << std::endl;
+  size_t slow = 0;
+  for (const auto &it : bad) {
+    bench_result_t r = run(it, iterations, throwing);
+    double expected = rejectNs + nsPerByte * it.message.size();
+    print(it, r);
+    std::cout << std::setw(7) << std::setprecision(2)
+              << r.nsPerMessage / expected << "x";
+    if (r.nsPerMessage > NOISE_MARGIN * expected) {
+      std::cout << "  expected " << std::setprecision(1) << expected;
+      slow++;
+    }
+    std::cout << std::endl;
+  }
+  return slow;
+}
+
+// QNAME handling after decoding vs one folding pass: hash only (what
+// QueryMatcher needs), lowercase copy and its hash (what full folding gives)
+static void report_names(const std::vector<corpus_entry_t> &corpus,
+                         size_t iterations) {
+  std::cout << "names:" << std::endl;
+  const char *titles[] = {"decode, hash", "decode, lower + hash", "folded",
+                          "folded, hash only"};
+  for (int method = 0; method < 4; method++) {
+    MessageParser mp;
+    mp.SetFoldQName(true, method == 3);
+    question_t question;
+    std::string lower;
+    folded_name_t folded;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+      for (const auto &it : corpus) {
+        mp.Reset(it.message.data(), it.message.size());
+        mp.GetHeader();
+        if (method >= 2) {
+          mp.GetQuestion(question, folded);
+          sum += folded.Hash;
+          continue;
+        }
+        mp.GetQuestion(question);
+        const std::string &name = question.QNAME;
+        if (method == 0) {
+          sum += hash_domain_name(name);
+          continue;
+        }
+        lower.resize(name.size());
+        for (size_t c = 0; c < name.size(); c++) {
+          bool upper = name[c] >= 'A' && name[c] <= 'Z';
+          lower[c] = upper ? name[c] + ('a' - 'A') : name[c];
+        }
+        sum += hash_bytes(reinterpret_cast<const uint8_t *>(lower.data()),
+                          lower.size());
+      }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << "  " << std::setw(28) << std::left << titles[method]
+              << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1)
+              << ns / iterations / corpus.size() << " ns/name"
+              << (sum ? "" : " ") << std::endl;
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t iterations = (argc > 1) ? std::stoul(argv[1]) : 20000;
+
+  auto wellFormed = load({"input", "inputQAA", "inputQAAAA", "inputQAAAd",
+                          "inputQAuthAdd", "inputQSRV"});
+  auto adversarial =
+      load({"adversarial/pointerLoop", "adversarial/labelPointerLoop",
+            "adversarial/pointerPingPong",
+            "adversarial/pointerChain", "adversarial/hugeCounts",
+            "adversarial/manyEmptyRecords", "adversarial/tooLongName",
+            "adversarial/reservedLabel"});
+
+  size_t slow = report(false, wellFormed, adversarial, iterations);
+  slow += report(true, wellFormed, adversarial, iterations);
+  report_names(wellFormed, iterations);
+
+  if (slow) {
+    std::cout << slow << " adversarial messages are slower than expected"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
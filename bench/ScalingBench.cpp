@@ -0,0 +1,174 @@
+// MessageParser scaling over threads on a corpus (see CorpusGen.cpp):
+//   make bench && ./dnsrrparser_corpus 1000000 > corpus.bin
+//   ./dnsrrparser_scaling corpus.bin [max threads] [passes]
+// corpus is split between threads, every thread reuses one parser. For 1..N
+// threads reports throughput, p50/p99 latency of a message and heap
+// allocations per message. Latency includes reading the clock, ~20-50 ns
+#include "MessageParser.h"
+#include "input.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+// per thread, so counting doesn't add contention of its own
+static thread_local size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *ret = std::malloc(size ? size : 1))
+    return ret;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+struct span_t {
+  const uint8_t *data;
+  size_t size;
+};
+
+struct thread_result_t {
+  std::vector<uint32_t> latencies; // ns
+  size_t allocations = 0;
+  size_t bytes = 0;
+  size_t malformed = 0;
+  std::chrono::steady_clock::time_point stop;
+};
+
+// threads wait for each other after warm-up: wall time covers measured
+// passes only, without thread start and warm-up
+struct start_gate_t {
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> open{false};
+};
+
+static void parse_shard(const span_t *begin, const span_t *end, size_t passes,
+                        start_gate_t &gate, thread_result_t &result) {
+  MessageParser mp;
+  dns_message_value_t dm;
+  // warm-up: parser and message get their capacity, pages are touched
+  for (const span_t *it = begin; it != end; it++) {
+    mp.Reset(it->data, it->size);
+    mp.TryGetDnsMessageValue(dm);
+  }
+  result.latencies.reserve((end - begin) * passes);
+
+  gate.ready++;
+  while (!gate.open)
+    std::this_thread::yield();
+
+  size_t before = allocations;
+  for (size_t pass = 0; pass < passes; pass++)
+    for (const span_t *it = begin; it != end; it++) {
+      auto start = std::chrono::steady_clock::now();
+      mp.Reset(it->data, it->size);
+      bool parsed = mp.TryGetDnsMessageValue(dm);
+      auto stop = std::chrono::steady_clock::now();
+      result.latencies.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+              .count());
+      result.malformed += !parsed;
+      result.bytes += it->size;
+    }
+  result.allocations = allocations - before;
+  result.stop = std::chrono::steady_clock::now();
+}
+
+static void run(const std::vector<span_t> &corpus, size_t threads,
+                size_t passes, double &single) {
+  std::vector<thread_result_t> results(threads);
+  std::vector<std::thread> workers;
+  start_gate_t gate;
+  size_t shard = (corpus.size() + threads - 1) / threads;
+
+  for (size_t i = 0; i < threads; i++) {
+    const span_t *begin = corpus.data() + std::min(corpus.size(), i * shard);
+    const span_t *end =
+        corpus.data() + std::min(corpus.size(), (i + 1) * shard);
+    workers.emplace_back(parse_shard, begin, end, passes, std::ref(gate),
+                         std::ref(results[i]));
+  }
+  while (gate.ready != threads)
+    std::this_thread::yield();
+  auto start = std::chrono::steady_clock::now();
+  gate.open = true;
+  for (auto &it : workers)
+    it.join();
+  auto stop = start;
+  for (auto &it : results)
+    stop = std::max(stop, it.stop);
+  double seconds = std::chrono::duration<double>(stop - start).count();
+
+  std::vector<uint32_t> latencies;
+  size_t allocs = 0;
+  size_t bytes = 0;
+  for (auto &it : results) {
+    latencies.insert(latencies.end(), it.latencies.begin(),
+                     it.latencies.end());
+    allocs += it.allocations;
+    bytes += it.bytes;
+  }
+  size_t messages = latencies.size();
+  auto percentile = [&latencies](double p) -> uint32_t {
+    if (latencies.empty())
+      return 0;
+    auto nth = latencies.begin() + (size_t)(p * (latencies.size() - 1));
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return *nth;
+  };
+  uint32_t p50 = percentile(0.5);
+  uint32_t p99 = percentile(0.99);
+
+  double rate = messages / seconds;
+  if (threads == 1)
+    single = rate;
+  std::cout << std::setw(7) << threads << std::fixed << std::setprecision(0)
+            << std::setw(14) << rate << std::setprecision(1) << std::setw(10)
+            << bytes / seconds / 1e6 << std::setw(9) << rate / single << "x"
+            << std::setw(9) << p50 << std::setw(9) << p99
+            << std::setprecision(4) << std::setw(12)
+            << (double)allocs / messages << std::endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " corpus [max threads] [passes]"
+              << std::endl;
+    return 1;
+  }
+  MappedInput input(argv[1]);
+  size_t maxThreads = (argc > 2) ? std::stoul(argv[2])
+                                 : std::max(1u, std::thread::hardware_concurrency());
+  size_t passes = (argc > 3) ? std::stoul(argv[3]) : 3;
+
+  std::vector<span_t> corpus;
+  size_t malformed = 0;
+  for_each_framed_message(input.data(), input.size(),
+                          [&](const uint8_t *message, size_t size) {
+                            corpus.push_back({message, size});
+                            MessageParser checker(message, size);
+                            malformed += checker.CheckDnsMessage() != nullptr;
+                          });
+  std::cout << corpus.size() << " messages, " << malformed << " malformed, "
+            << input.size() << " bytes, " << passes << " passes" << std::endl;
+  if (corpus.empty() || !passes) {
+    std::cerr << "nothing to measure" << std::endl;
+    return 1;
+  }
+  std::cout << "threads   messages/s      MB/s  speedup  p50(ns)  p99(ns)"
+               "  allocs/msg"
+            << std::endl;
+
+  double single = 0;
+  for (size_t threads = 1; threads <= maxThreads; threads++)
+    run(corpus, threads, passes, single);
+  return 0;
+}
@@ -0,0 +1,62 @@
+// libFuzzer target: make fuzz && ./dnsrrparser_fuzz inputs/
+// parsers should never crash, hang or disagree with CheckDnsMessage or
+// with each other
+#include "MessageParser.h"
+#include "formatters.h"
+#include "input.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  MessageParser checker(data, size);
+  const char *error = checker.CheckDnsMessage();
+
+  bool parsed = true;
+  try {
+    MessageParser mp(data, size);
+    dns_message_value_t dm = mp.GetDnsMessageValue();
+    std::stringstream ss;
+    ss << dm;
+  } catch (std::invalid_argument &e) {
+    parsed = false;
+  }
+
+  bool parsedRData = true;
+  try {
+    MessageParser mp(data, size);
+    dns_message_t dm = mp.GetDnsMessage();
+    std::stringstream ss;
+    ss << dm;
+  } catch (std::invalid_argument &e) {
+    parsedRData = false;
+  }
+
+  MessageParser tryParser(data, size);
+  dns_message_value_t tryDm;
+  bool tryParsed = tryParser.TryGetDnsMessageValue(tryDm);
+
+  if (parsed != (error == nullptr) || parsed != parsedRData ||
+      parsed != tryParsed)
+    std::abort();
+  return 0;
+}
+
+#ifdef FUZZ_REPLAY
+// without libFuzzer (gcc): run files given in arguments through the target.
+// files in Wireshark text format (like inputs/) are converted first
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::ifstream is(argv[i], std::ifstream::binary);
+    std::vector<uint8_t> raw((std::istreambuf_iterator<char>(is)),
+                             std::istreambuf_iterator<char>());
+    if (!raw.empty() && raw[0] == '"') {
+      std::stringstream ss(std::string(raw.begin(), raw.end()));
+      raw = get_raw_data(ss);
+    }
+    LLVMFuzzerTestOneInput(raw.data(), raw.size());
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,58 @@
+#ifndef DOMAIN_NAME
+#define DOMAIN_NAME
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// fast non-cryptographic hash, 8 bytes per step. It's built from steps below,
+// so a buffer growing by labels can be hashed while it's written
+uint64_t hash_bytes(const uint8_t *data, size_t size);
+
+const uint64_t HASH_SEED = 0x9e3779b97f4a7c15ULL;
+
+inline uint64_t hash_mix(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// one multiplication per word, bits are spread by hash_finish
+inline uint64_t hash_step(uint64_t hash, const uint8_t *word) {
+  uint64_t value;
+  std::memcpy(&value, word, sizeof(value));
+  return (((hash << 5) | (hash >> 59)) ^ value) * HASH_SEED;
+}
+
+// last size % 8 bytes, size is the whole size
+inline uint64_t hash_finish(uint64_t hash, const uint8_t *tail, size_t size) {
+  uint64_t value = 0;
+  std::memcpy(&value, tail, size % 8);
+  return hash_mix(hash_step(hash, reinterpret_cast<const uint8_t *>(&value)) +
+                  size);
+}
+
+// case-insensitive hash of a domain name: hash_bytes of its ASCII lowercase
+uint64_t hash_domain_name(const std::string &name);
+
+// by-products of decoding a name, see MessageParser::GetDomainName
+struct folded_name_t {
+  std::string Lowercase; // ASCII lowercase, as GetDomainName returns it
+  uint64_t Hash;         // hash_domain_name of the name
+  bool Hostname;         // labels are letters, digits, '-' and '_' only
+  // only Hash is filled: empty Lowercase, Hostname is false
+  bool HashOnly = false;
+};
+
+// copies length bytes of a label to out and their lowercase to lower, 16 bytes
+// per step. readable (>= length) bytes could be read from label, outputs need
+// 15 bytes of slack. Returns false if label has not a hostname character,
+// when asked to check. Without lower label is only copied
+bool fold_label(const uint8_t *label, size_t length, size_t readable, char *out,
+                char *lower, bool checkHostname = true);
+
+#endif
@@ -4,7 +4,7 @@
 #include "MessageParser.h"
 class GenericRData : public RData {
 protected:
-  std::vector<uint8_t> m_data;
+  generic_rdata_t m_data;
 
 public:
   GenericRData(MessageParser &mp, size_t RDLENGTH);
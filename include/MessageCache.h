@@ -0,0 +1,69 @@
+#ifndef MESSAGE_CACHE
+#define MESSAGE_CACHE
+
+#include "MessageParser.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct cached_message_t {
+  dns_message_value_t Message;
+  std::string Text; // formatted Message, empty if cache doesn't keep text
+};
+
+struct message_cache_stats_t {
+  uint64_t Hits = 0;
+  uint64_t Misses = 0;
+  uint64_t Evictions = 0;
+  uint64_t Malformed = 0;
+
+  double GetHitRate() const {
+    return (Hits + Misses) ? (double)Hits / (Hits + Misses) : 0;
+  }
+};
+
+// bounded LRU of parsed (and formatted) messages. Responses often differ
+// only in ID, so key is everything after it: a repeated message skips
+// parsing and formatting, only ID is patched. Not thread safe
+class MessageCache {
+public:
+  MessageCache(size_t capacity, bool withText = true);
+
+  // entry for message, parsed and formatted on miss. nullptr if message is
+  // malformed, error is set to reason then if not null. valid until next call
+  const cached_message_t *Get(const uint8_t *message, size_t size,
+                              const char **error = nullptr);
+
+  const message_cache_stats_t &GetStats() const { return m_stats; }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct entry_t {
+    uint64_t hash;
+    std::vector<uint8_t> key; // message without ID
+    cached_message_t value;
+    size_t idOffset; // ID digits in value.Text, npos if there are none
+    size_t idLength;
+    uint32_t prev;
+    uint32_t next;
+  };
+
+  void PatchId(entry_t &entry, uint16_t id);
+  void Unlink(uint32_t index);
+  void PushFront(uint32_t index);
+
+  bool m_withText;
+  message_cache_stats_t m_stats;
+  MessageParser m_parser;
+
+  std::vector<entry_t> m_entries;
+  size_t m_used;
+  // most recently used first
+  uint32_t m_head;
+  uint32_t m_tail;
+  std::unordered_map<uint64_t, uint32_t> m_index;
+};
+
+#endif
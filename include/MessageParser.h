@@ -1,39 +1,133 @@
 #ifndef MESSAGE_PASER
 #define MESSAGE_PASER
+#include "DomainName.h"
 #include "dns_structures.h"
 
 #include <cstring>
 #include <memory>
+#include <stdexcept>
+#include <tuple>
 #include <vector>
 
 uint16_t ntoh(uint16_t net);
 uint32_t ntoh(uint32_t net);
 
+// non-throwing walk over wire format, as CheckDnsMessage does it. on success
+// offset is moved behind the name / RDATA, otherwise reason is returned
+const char *skip_domain_name(const uint8_t *data, size_t size, size_t &offset,
+                             bool couldBeCompressed);
+const char *skip_rdata(const uint8_t *data, size_t size, size_t &offset,
+                       uint16_t type, size_t RDLENGTH);
+
+// vector of spare values for every alternative of a variant
+template <typename V> struct spare_alternatives_t;
+template <typename... Ts> struct spare_alternatives_t<std::variant<Ts...>> {
+  std::tuple<std::vector<Ts>...> pools;
+  template <typename T> std::vector<T> &Get() {
+    return std::get<std::vector<T>>(pools);
+  }
+};
+
 class MessageParser {
 public:
+  MessageParser();
   MessageParser(std::vector<uint8_t> &&message);
+  // doesn't copy message, it should outlive parser (mmaped input etc.)
+  MessageParser(const uint8_t *message, size_t size);
+  MessageParser(const MessageParser &) = delete;
+  MessageParser(MessageParser &&) = default;
+
+  // start next message with the same parser: spare section entries are kept,
+  // so one parser per thread stops allocating after a while
+  void Reset(std::vector<uint8_t> &&message);
+  void Reset(const uint8_t *message, size_t size);
+  // GetDnsMessageValue fills FoldedQNAME of the message: query matching and
+  // caches by QNAME don't have to lowercase and hash it again. hashOnly
+  // leaves Lowercase empty and skips hostname check, for callers which need
+  // the hash only (QueryMatcher): full folding costs more than hashing a
+  // decoded name, hash only costs about the same, in one pass
+  void SetFoldQName(bool fold, bool hashOnly = false) {
+    m_foldQName = fold;
+    m_foldHashOnly = hashOnly;
+  }
 
   dns_message_t GetDnsMessage();
   header_t GetHeader();
   question_t GetQuestion();
+  void GetQuestion(question_t &ret);
+  // QNAME is folded as SetFoldQName asks: hash only or fully
+  void GetQuestion(question_t &ret, folded_name_t &folded);
   resource_record_t GetResourceRecord();
   std::unique_ptr<RData> GetRData(uint16_t type);
+  dns_message_value_t GetDnsMessageValue();
+  // fills ret in place reusing its vectors and strings. content of ret is
+  // unspecified if exception is thrown
+  void GetDnsMessageValue(dns_message_value_t &ret);
+  // hostile traffic: malformed messages are rejected without exceptions, in
+  // the same pass that parses valid ones. error is set to reason if not null
+  bool TryGetDnsMessageValue(dns_message_value_t &ret,
+                             const char **error = nullptr);
+  // nullptr if GetDnsMessage would succeed, error description otherwise
+  const char *CheckDnsMessage() const;
+  resource_record_value_t GetResourceRecordValue();
+  void GetResourceRecordValue(resource_record_value_t &ret);
+  rdata_value_t GetRDataValue(uint16_t type);
+  void GetRDataValue(uint16_t type, rdata_value_t &ret);
   std::string GetDomainName(bool couldBeCompressed = true);
+  void GetDomainName(std::string &ret, bool couldBeCompressed = true);
+  // the same pass also gives lowercase, case-insensitive hash and hostname
+  // check of the name
+  void GetDomainName(std::string &ret, folded_name_t &folded,
+                     bool couldBeCompressed = true);
   std::vector<uint8_t> GetRawData(size_t length);
+  void GetRawData(uint8_t *dst, size_t length);
+  // malformed message: throws std::invalid_argument, but inside
+  // TryGetDnsMessageValue only the first reason is kept and offset moves to
+  // the end, so the rest of parsing fails fast. Callers return after it
+  void Fail(const char *reason);
   template <typename T> T Get() {
     T ret;
-    if (m_offset + sizeof(ret) > m_raw_data.size())
-      throw std::invalid_argument("out of bound");
-    std::memcpy(&ret, m_raw_data.data() + m_offset, sizeof(ret));
+    if (m_offset + sizeof(ret) > m_size) {
+      Fail("out of bound");
+      return T();
+    }
+    std::memcpy(&ret, m_data + m_offset, sizeof(ret));
     m_offset += sizeof(ret);
     ret = ntoh(ret);
     return ret;
   }
   size_t GetCurrentOffset() { return m_offset; };
+  size_t GetSize() const { return m_size; }
+  // e.g. to decode a name found by skip_domain_name
+  void Seek(size_t offset) { m_offset = offset; }
 
 private:
+  void DecodeDomainName(std::string &ret, folded_name_t *folded,
+                        bool hashOnly, bool couldBeCompressed);
+  template <typename T> T &RDataAs(rdata_value_t &rdata);
+  size_t GetReserveLimit(uint16_t count, size_t minSize);
+  template <typename T>
+  void GetSection(std::vector<T> &section, uint16_t count, size_t minSize,
+                  std::vector<T> &spare, folded_name_t *foldFirst = nullptr);
+
   size_t m_offset;
-  std::vector<uint8_t> m_raw_data;
+  std::vector<uint8_t> m_raw_data; // empty for non-owning parser
+  const uint8_t *m_data;
+  size_t m_size;
+  bool m_throwing;
+  const char *m_error; // first Fail reason when not throwing
+  bool m_foldQName;
+  bool m_foldHashOnly;
+
+  // entries cut from sections of previous messages, with strings capacity.
+  // Every section has its own: an entry comes back to the same position, and
+  // its NAME has capacity for names seen there
+  std::vector<question_t> m_spareQuestions;
+  std::vector<resource_record_value_t> m_spareAnswer;
+  std::vector<resource_record_value_t> m_spareAuthority;
+  std::vector<resource_record_value_t> m_spareAdditional;
+  // RDATA replaced by another type, see RDataAs
+  spare_alternatives_t<rdata_value_t> m_spareRData;
 };
 
 #endif
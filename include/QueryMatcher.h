@@ -0,0 +1,102 @@
+#ifndef QUERY_MATCHER
+#define QUERY_MATCHER
+
+#include "DomainName.h"
+#include "dns_structures.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// addresses and ports of a captured packet. IPv4 address takes first 4 bytes,
+// the rest is zero
+struct flow_t {
+  std::array<uint8_t, 16> SrcAddress;
+  std::array<uint8_t, 16> DstAddress;
+  uint16_t SrcPort;
+  uint16_t DstPort;
+};
+
+// query and its response, or query without response in time. Flow is
+// oriented from client to server
+struct match_t {
+  uint16_t ID;
+  uint16_t QTYPE;
+  uint64_t QNameHash;
+  flow_t Flow;
+  uint64_t QueryTime;
+  uint64_t Latency; // 0 if timed out
+  bool TimedOut;
+};
+
+struct matcher_stats_t {
+  uint64_t Queries = 0;
+  uint64_t Responses = 0;
+  uint64_t Matched = 0;
+  uint64_t TimedOut = 0;
+  uint64_t UnmatchedResponses = 0;
+  uint64_t Duplicates = 0; // retransmits of outstanding query, ignored
+  uint64_t Overflows = 0;  // no room for query, ignored
+  uint64_t Ignored = 0;    // no question section
+};
+
+// pairs queries with responses by (ID, QNAME, QTYPE, flow). Outstanding
+// queries live in a fixed-size open addressing table and a timing wheel,
+// so memory doesn't depend on traffic and expiration costs O(1) per query.
+// Times are in microseconds, e.g. capture timestamps. Not thread safe
+class QueryMatcher {
+public:
+  typedef std::function<void(const match_t &)> Handler;
+
+  QueryMatcher(uint64_t timeout, size_t capacity, Handler handler,
+               uint64_t tick = 1000);
+
+  // advances time as well. Folded QNAME of dm is used if it's there (see
+  // MessageParser::SetFoldQName), otherwise QNAME is hashed here
+  void OnMessage(const dns_message_value_t &dm, const flow_t &flow,
+                 uint64_t time);
+  // expires queries older than timeout
+  void Advance(uint64_t time);
+  // end of capture: all outstanding queries are reported as timed out
+  void Flush();
+
+  const matcher_stats_t &GetStats() const { return m_stats; }
+  size_t GetOutstanding() const { return m_entries.size() - m_free.size(); }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct entry_t {
+    uint64_t hash;
+    uint64_t qnameHash;
+    flow_t flow;
+    uint16_t id;
+    uint16_t qtype;
+    uint64_t time;
+    uint64_t expireTick;
+    uint32_t wheelPrev;
+    uint32_t wheelNext;
+  };
+
+  void OnQuery(const entry_t &query);
+  void OnResponse(const entry_t &response, uint64_t time);
+  uint32_t Find(const entry_t &key, size_t &slot) const;
+  void Remove(size_t slot);
+  void Report(uint32_t index, uint64_t latency, bool timedOut);
+
+  uint64_t m_timeout;
+  uint64_t m_tick;
+  uint64_t m_currentTick;
+  Handler m_handler;
+  matcher_stats_t m_stats;
+
+  std::vector<entry_t> m_entries;
+  std::vector<uint32_t> m_free;
+  // open addressing, linear probing: entry index or NONE
+  std::vector<uint32_t> m_slots;
+  // entries of every wheel slot expire at the same tick
+  std::vector<uint32_t> m_wheel;
+};
+
+#endif
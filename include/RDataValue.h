@@ -0,0 +1,105 @@
+#ifndef RDATA_VALUE
+#define RDATA_VALUE
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+class MessageParser;
+
+// value-type counterparts of RDatas.cpp classes. resource_record_t keeps a
+// unique_ptr<RData> (heap allocation + vtable per record), these are stored
+// inline in std::vector, so RDATA needs no heap node or vtable. names and
+// other strings still allocate once they outgrow the small string buffer
+// (15 chars on libstdc++).
+// Parse() fills existing object, so strings keep their capacity when a
+// message storage is reused, which removes those remaining allocations
+struct a_rdata_t {
+  std::array<uint8_t, 4> ADDRESS;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, a_rdata_t &ret);
+  operator std::string() const;
+};
+
+struct aaaa_rdata_t {
+  std::array<uint8_t, 16> ADDRESS;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, aaaa_rdata_t &ret);
+  operator std::string() const;
+};
+
+// NS, CNAME, PTR
+struct domain_rdata_t {
+  std::string DOMAIN;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, domain_rdata_t &ret);
+  operator std::string() const;
+};
+
+struct mx_rdata_t {
+  uint16_t PREFERENCE;
+  std::string EXCHANGE;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, mx_rdata_t &ret);
+  operator std::string() const;
+};
+
+struct txt_rdata_t {
+  std::string TXT;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, txt_rdata_t &ret);
+  operator std::string() const;
+};
+
+struct soa_rdata_t {
+  std::string MNAME;
+  std::string RNAME;
+  uint32_t SERIAL;
+  uint32_t REFRESH;
+  uint32_t RETRY;
+  uint32_t EXPIRE;
+  uint32_t MINIMUM;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, soa_rdata_t &ret);
+  operator std::string() const;
+};
+
+struct srv_rdata_t {
+  uint16_t PRIORITY;
+  uint16_t WEIGHT;
+  uint16_t PORT;
+  std::string TARGET;
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, srv_rdata_t &ret);
+  operator std::string() const;
+};
+
+// unknown types: small RDATA (OPT without options, etc.) is kept inline,
+// bigger one goes to heap
+struct generic_rdata_t {
+  static const size_t INLINE_SIZE = 30;
+
+  generic_rdata_t() = default;
+  generic_rdata_t(const uint8_t *data, size_t size);
+
+  const uint8_t *data() const;
+  size_t size() const { return m_size; }
+
+  static void Parse(MessageParser &mp, size_t RDLENGTH, generic_rdata_t &ret);
+  operator std::string() const;
+
+private:
+  uint16_t m_size = 0;
+  std::array<uint8_t, INLINE_SIZE> m_inline;
+  std::vector<uint8_t> m_heap;
+};
+
+typedef std::variant<generic_rdata_t, a_rdata_t, aaaa_rdata_t, domain_rdata_t,
+                     mx_rdata_t, txt_rdata_t, soa_rdata_t, srv_rdata_t>
+    rdata_value_t;
+
+std::string to_string(const rdata_value_t &rdata);
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef UDP_LISTENER
+#define UDP_LISTENER
+
+#include "QueryMatcher.h"
+#include "dns_structures.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// fixed set of equally sized receive buffers, reused forever: no allocations
+// after start
+class BufferPool {
+public:
+  BufferPool(size_t count, size_t bufferSize);
+
+  // blocks until at least one buffer is free, then takes up to max of them
+  size_t Acquire(uint8_t **buffers, size_t max);
+  void Release(uint8_t *buffer);
+  size_t GetBufferSize() const { return m_bufferSize; }
+
+private:
+  size_t m_bufferSize;
+  std::vector<uint8_t> m_storage;
+  std::vector<uint8_t *> m_free;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+};
+
+struct listener_stats_t {
+  std::atomic<uint64_t> Received{0};
+  std::atomic<uint64_t> Truncated{0}; // bigger than pool buffer, dropped
+  std::atomic<uint64_t> Parsed{0};
+  std::atomic<uint64_t> Malformed{0};
+  std::atomic<uint64_t> HandlerFailed{0}; // handler threw, worker goes on
+};
+
+// where a datagram came from and when. Flow goes from the sender to the
+// listening address (destination address of the packet, for 0.0.0.0 too).
+// Time is the kernel receive timestamp (SO_TIMESTAMP), microseconds since
+// epoch
+struct datagram_info_t {
+  flow_t Flow;
+  uint64_t Time;
+};
+
+// passive listener on UDP socket: one thread receives datagrams in batches
+// (epoll + recvmmsg), workers parse them and call handler with result.
+// handler is called concurrently from worker threads, exceptions thrown by it
+// are counted and dropped
+class UdpListener {
+public:
+  typedef std::function<void(const dns_message_value_t &,
+                             const datagram_info_t &)>
+      Handler;
+
+  static const size_t BATCH_SIZE = 64;
+
+  // port 0 means any free port, see GetPort()
+  UdpListener(const std::string &address, uint16_t port, Handler handler,
+              size_t workers = 1, size_t buffers = 1024,
+              size_t bufferSize = 4096);
+  UdpListener(const UdpListener &) = delete;
+  UdpListener &operator=(const UdpListener &) = delete;
+  ~UdpListener();
+
+  uint16_t GetPort() const { return m_port; }
+  // workers parse messages with MessageParser::SetFoldQName, before Run()
+  void SetFoldQName(bool fold, bool hashOnly = false) {
+    m_foldQName = fold;
+    m_foldHashOnly = hashOnly;
+  }
+  const listener_stats_t &GetStats() const { return m_stats; }
+
+  // blocks until Stop() is called, could be run in separate thread
+  void Run();
+  // safe to call from any thread or before Run()
+  void Stop();
+
+private:
+  struct datagram_t {
+    uint8_t *buffer;
+    size_t size;
+    datagram_info_t info;
+  };
+
+  void Close();
+  void ReceiveBatch();
+  void Work();
+
+  int m_socket;
+  int m_epoll;
+  int m_stopEvent;
+  uint16_t m_port;
+  // network order, destination if packet info isn't there
+  uint32_t m_address;
+  Handler m_handler;
+  size_t m_workers;
+  bool m_foldQName;
+  bool m_foldHashOnly;
+  BufferPool m_pool;
+  listener_stats_t m_stats;
+
+  // ring of received datagrams, as big as pool
+  std::vector<datagram_t> m_queue;
+  size_t m_queueHead;
+  size_t m_queueSize;
+  bool m_stopping;
+  // checked between batches: socket could be never drained under load
+  std::atomic<bool> m_stopRequested;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+};
+
+#endif
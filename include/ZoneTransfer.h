@@ -0,0 +1,78 @@
+#ifndef ZONE_TRANSFER
+#define ZONE_TRANSFER
+
+#include "MessageParser.h"
+
+#include <functional>
+#include <ostream>
+#include <vector>
+
+// appends uncompressed wire format of a name / record. names are dotted
+// strings as GetDomainName returns them
+void append_wire_name(std::vector<uint8_t> &out, const std::string &name);
+void append_wire_record(std::vector<uint8_t> &out,
+                        const resource_record_value_t &record);
+
+// AXFR/IXFR response stream (TCP: 2-byte length + message, many messages)
+// parsed record by record. Only one message and one record are kept in
+// memory, so memory doesn't depend on zone size.
+//
+// Records are passed to handler in transfer order. AXFR records are all
+// added, closing SOA isn't passed. For incremental IXFR every difference
+// sequence is "old SOA + deleted records, new SOA + added records", the
+// leading and closing SOA aren't passed.
+class ZoneTransferParser {
+public:
+  typedef std::function<void(const resource_record_value_t &, bool deleted)>
+      Handler;
+
+  explicit ZoneTransferParser(Handler handler);
+
+  // arbitrary chunk of TCP stream, frames could be split anywhere
+  void Feed(const uint8_t *data, size_t size);
+  // one message without length prefix
+  void OnMessage(const uint8_t *message, size_t size);
+
+  bool IsComplete() const { return m_state == COMPLETE; }
+  bool IsIncremental() const {
+    return m_state == IXFR_DELETE || m_state == IXFR_ADD ||
+           (m_state == COMPLETE && m_incremental);
+  }
+  uint32_t GetSerial() const { return m_serial; }
+  size_t GetMessageCount() const { return m_messages; }
+  size_t GetRecordCount() const { return m_records; }
+
+private:
+  enum state_t { START, FIRST_SOA, AXFR, IXFR_DELETE, IXFR_ADD, COMPLETE };
+
+  void OnRecord(const resource_record_value_t &record);
+  void Emit(const resource_record_value_t &record, bool deleted);
+
+  Handler m_handler;
+  state_t m_state;
+  bool m_incremental;
+  uint32_t m_serial;
+  size_t m_messages;
+  size_t m_records;
+
+  MessageParser m_parser;
+  question_t m_question;
+  resource_record_value_t m_record;
+  // leading SOA: for AXFR it's the first record of zone, for IXFR just a
+  // marker. it's not known until next record
+  resource_record_value_t m_firstSoa;
+  // frame split between chunks
+  std::vector<uint8_t> m_pending;
+};
+
+// master file text (rfc-1035 5.1): one record per line, deleted records are
+// commented. Names are absolute with special characters escaped, TXT is
+// quoted, unknown types and classes are in rfc-3597 form
+void write_zone_text(std::ostream &os, const resource_record_value_t &record,
+                     bool deleted);
+// binary: 1 byte (0 - added, 1 - deleted), 2-byte length in network order,
+// record in uncompressed wire format
+void write_zone_binary(std::ostream &os, const resource_record_value_t &record,
+                       bool deleted);
+
+#endif
@@ -4,6 +4,29 @@
 #include <unordered_map>
 const size_t UDP_SIZE_LIMIT = 512;
 const size_t MAX_NAME_LENGTH = 255;
+// name has at most 127 labels, every compression pointer should lead to one
+// of them. Pointing back from the pointer alone doesn't prevent loops (label
+// at 12, pointer at 14 -> 12), so parser wants every pointer to go before
+// the previous target. Chain of them still could be long: this keeps cost
+// of a name constant
+const size_t MAX_POINTER_HOPS = 127;
+// smallest question: root name + QTYPE + QCLASS
+const size_t MIN_QUESTION_SIZE = 5;
+// smallest resource record: root name + TYPE + CLASS + TTL + RDLENGTH
+const size_t MIN_RESOURCE_RECORD_SIZE = 11;
+
+enum rr_type : uint16_t {
+  TYPE_A = 1,
+  TYPE_NS = 2,
+  TYPE_CNAME = 5,
+  TYPE_SOA = 6,
+  TYPE_PTR = 12,
+  TYPE_MX = 15,
+  TYPE_TXT = 16,
+  TYPE_AAAA = 28,
+  TYPE_SRV = 33,
+  TYPE_AXFR = 252,
+};
 
 // All maps could be replaced by std::array
 const std::unordered_map<uint16_t, std::string> types = {
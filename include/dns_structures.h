@@ -1,7 +1,9 @@
 #ifndef DNS_STRUCTURES
 #define DNS_STRUCTURES
 
+#include "DomainName.h"
 #include "RData.h"
+#include "RDataValue.h"
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -31,6 +33,15 @@ struct resource_record_t {
   std::unique_ptr<RData> RDATA;
 };
 
+// same as resource_record_t, but RDATA is stored by value
+struct resource_record_value_t {
+  std::string NAME;
+  uint16_t TYPE;
+  uint16_t CLASS;
+  uint32_t TTL;
+  rdata_value_t RDATA;
+};
+
 struct dns_message_t {
   header_t Header;
   std::vector<question_t> Question;
@@ -39,4 +50,16 @@ struct dns_message_t {
   std::vector<resource_record_t> Additional;
 };
 
+struct dns_message_value_t {
+  header_t Header;
+  std::vector<question_t> Question;
+  std::vector<resource_record_value_t> Answer;
+  std::vector<resource_record_value_t> Authority;
+  std::vector<resource_record_value_t> Additional;
+  // lowercase and hash of Question[0].QNAME from the same decoding pass, if
+  // parser was asked for it (MessageParser::SetFoldQName), or the hash only
+  bool HasFoldedQNAME = false;
+  folded_name_t FoldedQNAME;
+};
+
 #endif
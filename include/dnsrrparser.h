@@ -0,0 +1,100 @@
+#ifndef DNSRRPARSER_C_API
+#define DNSRRPARSER_C_API
+
+/* C interface of libdnsrrparser.so for FFI (Go, Python, ...). Plain structs
+ * with fixed-size fields, no exceptions or C++ types cross it. Messages are
+ * not copied: results are offsets into the caller's buffers. All functions
+ * are thread safe, there is no global state */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DNSRR_ABI_VERSION 1
+
+#if defined(__GNUC__)
+#define DNSRR_API __attribute__((visibility("default")))
+#else
+#define DNSRR_API
+#endif
+
+enum dnsrr_status {
+  DNSRR_OK = 0,
+  DNSRR_MALFORMED = 1,
+  /* more entries than the whole capacity of the call, entry_count is how
+   * many are needed */
+  DNSRR_TOO_MANY_ENTRIES = 2,
+};
+
+enum dnsrr_section {
+  DNSRR_QUESTION = 0,
+  DNSRR_ANSWER = 1,
+  DNSRR_AUTHORITY = 2,
+  DNSRR_ADDITIONAL = 3,
+};
+
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+} dnsrr_buffer_t;
+
+typedef struct {
+  uint16_t id;
+  uint8_t qr, opcode, aa, tc, rd, ra, z, rcode;
+  uint16_t qdcount;
+  uint16_t ancount;
+  uint16_t nscount;
+  uint16_t arcount;
+} dnsrr_header_t;
+
+/* question or resource record. name_length is the size of name in place,
+ * up to terminating zero label or compression pointer, use
+ * dnsrr_decode_name to get text. questions have zero ttl and RDATA */
+typedef struct {
+  uint32_t name_offset;
+  uint16_t name_length;
+  uint16_t section;
+  uint16_t type;
+  uint16_t rclass;
+  uint32_t ttl;
+  uint32_t rdata_offset;
+  uint32_t rdata_length;
+} dnsrr_entry_t;
+
+typedef struct {
+  int32_t status;
+  /* static string, NULL if status is DNSRR_OK */
+  const char *error;
+  dnsrr_header_t header;
+  /* entries of the message in sections order, index in entries of the call */
+  uint32_t first_entry;
+  uint32_t entry_count;
+} dnsrr_message_t;
+
+DNSRR_API uint32_t dnsrr_abi_version(void);
+
+/* parses count messages into messages[i] and entries. Malformed messages get
+ * DNSRR_MALFORMED status and no entries, messages with more entries than
+ * capacity get DNSRR_TOO_MANY_ENTRIES and no entries. Stops early if entries
+ * of a message don't fit in what is left, returns number of parsed messages
+ * then: pass the rest in the next call. messages from the returned index on
+ * are left untouched, entries after *used are unspecified. *used is number
+ * of filled entries */
+DNSRR_API size_t dnsrr_parse_batch(const dnsrr_buffer_t *buffers, size_t count,
+                                   dnsrr_message_t *messages,
+                                   dnsrr_entry_t *entries, size_t capacity,
+                                   size_t *used);
+
+/* writes name at offset of a message as dotted zero-terminated text.
+ * Returns text length or -1 if name is malformed or doesn't fit */
+DNSRR_API int dnsrr_decode_name(const uint8_t *message, size_t size,
+                                uint32_t offset, char *out, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
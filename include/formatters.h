@@ -6,3 +6,6 @@ std::ostream &operator<<(std::ostream &os, question_t q);
 std::ostream &operator<<(std::ostream &os, const std::unique_ptr<RData> &d);
 std::ostream &operator<<(std::ostream &os, const resource_record_t &r);
 std::ostream &operator<<(std::ostream &os, const dns_message_t &d);
+std::ostream &operator<<(std::ostream &os, const rdata_value_t &d);
+std::ostream &operator<<(std::ostream &os, const resource_record_value_t &r);
+std::ostream &operator<<(std::ostream &os, const dns_message_value_t &d);
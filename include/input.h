@@ -1,7 +1,52 @@
 #ifndef DNS_INPUT
 #define DNS_INPUT
 
-#include <vector>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 std::vector<uint8_t> get_raw_data(std::istream &is);
+
+// whole file mapped read-only with sequential access hint. stdin could be
+// passed as fd too: if it's a pipe, not a regular file, it's read to memory
+class MappedInput {
+public:
+  explicit MappedInput(const std::string &path);
+  explicit MappedInput(int fd);
+  MappedInput(const MappedInput &) = delete;
+  MappedInput &operator=(const MappedInput &) = delete;
+  ~MappedInput();
+
+  const uint8_t *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  void Map(int fd);
+
+  const uint8_t *m_data;
+  size_t m_size;
+  bool m_mapped;
+  std::vector<uint8_t> m_buffer;
+};
+
+// binary archive is a sequence of frames: 2-byte length in network order
+// followed by wire-format message (same as DNS over TCP).
+// f(const uint8_t *message, size_t size) is called for every frame, message
+// points inside data, nothing is copied
+template <typename F>
+void for_each_framed_message(const uint8_t *data, size_t size, F f) {
+  size_t offset = 0;
+  while (offset < size) {
+    if (offset + 2 > size)
+      throw std::invalid_argument("archive cut in frame length");
+    size_t length = (data[offset] << 8) | data[offset + 1];
+    offset += 2;
+    if (offset + length > size)
+      throw std::invalid_argument("archive cut in message");
+    f(data + offset, length);
+    offset += length;
+  }
+}
+
 #endif
@@ -0,0 +1,138 @@
+#include "MessageParser.h"
+#include "dnsrrparser.h"
+
+static uint16_t get16(const uint8_t *data, size_t at) {
+  return (data[at] << 8) | data[at + 1];
+}
+
+static uint32_t get32(const uint8_t *data, size_t at) {
+  return ((uint32_t)get16(data, at) << 16) | get16(data, at + 2);
+}
+
+static dnsrr_header_t get_header(const uint8_t *data) {
+  dnsrr_header_t ret;
+  ret.id = get16(data, 0);
+  uint16_t flags = get16(data, 2);
+  ret.qr = flags >> 15;
+  ret.opcode = (flags >> 11) & 0xF;
+  ret.aa = (flags >> 10) & 0x1;
+  ret.tc = (flags >> 9) & 0x1;
+  ret.rd = (flags >> 8) & 0x1;
+  ret.ra = (flags >> 7) & 0x1;
+  ret.z = (flags >> 4) & 0x7;
+  ret.rcode = flags & 0xF;
+  ret.qdcount = get16(data, 4);
+  ret.ancount = get16(data, 6);
+  ret.nscount = get16(data, 8);
+  ret.arcount = get16(data, 10);
+  return ret;
+}
+
+// same walk as CheckDnsMessage. entries are written while they fit, the walk
+// goes on anyway: malformed message is reported as such even if it's too big
+static const char *scan_message(const uint8_t *data, size_t size,
+                                dnsrr_message_t &message,
+                                dnsrr_entry_t *entries, size_t capacity,
+                                bool &fits) {
+  const size_t headerSize = sizeof(uint16_t) * 6;
+  if (size < headerSize)
+    return "could not parse dns header";
+  message.header = get_header(data);
+
+  const uint16_t counts[] = {message.header.qdcount, message.header.ancount,
+                             message.header.nscount, message.header.arcount};
+  size_t offset = headerSize;
+  size_t count = 0;
+  const char *error;
+  for (uint16_t section = DNSRR_QUESTION; section <= DNSRR_ADDITIONAL;
+       section++) {
+    for (uint16_t i = 0; i < counts[section]; i++) {
+      dnsrr_entry_t entry = {};
+      entry.name_offset = offset;
+      entry.section = section;
+      if ((error = skip_domain_name(data, size, offset, true)))
+        return error;
+      entry.name_length = offset - entry.name_offset;
+      if (section == DNSRR_QUESTION) {
+        if (offset + 4 > size)
+          return "out of bound";
+        entry.type = get16(data, offset);
+        entry.rclass = get16(data, offset + 2);
+        offset += 4;
+      } else {
+        if (offset + 10 > size)
+          return "out of bound";
+        entry.type = get16(data, offset);
+        entry.rclass = get16(data, offset + 2);
+        entry.ttl = get32(data, offset + 4);
+        entry.rdata_length = get16(data, offset + 8);
+        offset += 10;
+        entry.rdata_offset = offset;
+        if ((error = skip_rdata(data, size, offset, entry.type,
+                                entry.rdata_length)))
+          return error;
+      }
+      if (count < capacity)
+        entries[count] = entry;
+      count++;
+    }
+  }
+  fits = count <= capacity;
+  message.entry_count = count;
+  return nullptr;
+}
+
+uint32_t dnsrr_abi_version(void) { return DNSRR_ABI_VERSION; }
+
+size_t dnsrr_parse_batch(const dnsrr_buffer_t *buffers, size_t count,
+                         dnsrr_message_t *messages, dnsrr_entry_t *entries,
+                         size_t capacity, size_t *used) {
+  size_t filled = 0;
+  size_t i = 0;
+  for (; i < count; i++) {
+    // messages[i] isn't touched if entries don't fit
+    dnsrr_message_t message = dnsrr_message_t();
+    message.first_entry = filled;
+    bool fits = false;
+    message.error =
+        scan_message(buffers[i].data, buffers[i].size, message,
+                     entries + filled, capacity - filled, fits);
+    if (message.error) {
+      message.status = DNSRR_MALFORMED;
+      message.entry_count = 0;
+    } else if (fits) {
+      message.status = DNSRR_OK;
+      filled += message.entry_count;
+    } else if (message.entry_count > capacity) {
+      // no call with this capacity fits it, don't stop on it forever
+      message.status = DNSRR_TOO_MANY_ENTRIES;
+      message.error = "too many entries";
+    } else {
+      break;
+    }
+    messages[i] = message;
+  }
+  if (used)
+    *used = filled;
+  return i;
+}
+
+int dnsrr_decode_name(const uint8_t *message, size_t size, uint32_t offset,
+                      char *out, size_t capacity) {
+  size_t end = offset;
+  if (!message || !out || skip_domain_name(message, size, end, true))
+    return -1;
+  // checked above, nothing could throw except allocation
+  try {
+    MessageParser mp(message, size);
+    mp.Seek(offset);
+    std::string name;
+    mp.GetDomainName(name);
+    if (name.size() + 1 > capacity)
+      return -1;
+    std::memcpy(out, name.c_str(), name.size() + 1);
+    return name.size();
+  } catch (...) {
+    return -1;
+  }
+}
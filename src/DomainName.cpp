@@ -0,0 +1,93 @@
+#include "DomainName.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+uint64_t hash_bytes(const uint8_t *data, size_t size) {
+  uint64_t hash = HASH_SEED;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+    hash = hash_step(hash, data + i);
+  return hash_finish(hash, data + i, size);
+}
+
+static uint8_t to_lower(uint8_t c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+uint64_t hash_domain_name(const std::string &name) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(name.data());
+  uint8_t word[8];
+  uint64_t hash = HASH_SEED;
+  size_t i = 0;
+  for (; i + 8 <= name.size(); i += 8) {
+    for (size_t j = 0; j < 8; j++)
+      word[j] = to_lower(data[i + j]);
+    hash = hash_step(hash, word);
+  }
+  for (size_t j = 0; i + j < name.size(); j++)
+    word[j] = to_lower(data[i + j]);
+  return hash_finish(hash, word, name.size());
+}
+
+#ifdef __SSE2__
+
+// x in [from, from + count) for signed bytes: shift range to the bottom
+static __m128i in_range(__m128i x, char from, char count) {
+  __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - from)));
+  return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-0x80 + count)));
+}
+
+bool fold_label(const uint8_t *label, size_t length, size_t readable, char *out,
+                char *lower, bool checkHostname) {
+  int invalid = 0;
+  for (size_t i = 0; i < length; i += 16) {
+    __m128i v;
+    if (readable - i >= 16) {
+      v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(label + i));
+    } else {
+      // end of message is near: don't read past it
+      alignas(16) uint8_t buffer[16] = {};
+      std::memcpy(buffer, label + i, length - i);
+      v = _mm_load_si128(reinterpret_cast<const __m128i *>(buffer));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+    if (!lower)
+      continue;
+
+    __m128i upper = in_range(v, 'A', 26);
+    v = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lower + i), v);
+    if (!checkHostname)
+      continue;
+
+    __m128i ok = _mm_or_si128(in_range(v, 'a', 26), in_range(v, '0', 10));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    int mask = ~_mm_movemask_epi8(ok) & 0xffff;
+    if (length - i < 16)
+      mask &= (1 << (length - i)) - 1;
+    invalid |= mask;
+  }
+  return !invalid;
+}
+
+#else
+
+bool fold_label(const uint8_t *label, size_t length, size_t, char *out,
+                char *lower, bool checkHostname) {
+  std::memcpy(out, label, length);
+  if (!lower)
+    return true;
+  bool valid = true;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = to_lower(label[i]);
+    lower[i] = c;
+    valid &= !checkHostname || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+             c == '_';
+  }
+  return valid;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include "input.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+MappedInput::MappedInput(const std::string &path)
+    : m_data(nullptr), m_size(0), m_mapped(false) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  try {
+    Map(fd);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  // mapping stays valid after close
+  close(fd);
+}
+
+MappedInput::MappedInput(int fd) : m_data(nullptr), m_size(0), m_mapped(false) {
+  Map(fd);
+}
+
+MappedInput::~MappedInput() {
+  if (m_mapped)
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+}
+
+void MappedInput::Map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    throw std::system_error(errno, std::generic_category(), "fstat");
+
+  if (S_ISREG(st.st_mode)) {
+    m_size = st.st_size;
+    if (m_size == 0)
+      return; // mmap doesn't like zero length
+    void *addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    // kernel could read ahead aggressively and drop pages behind us
+    madvise(addr, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t *>(addr);
+    m_mapped = true;
+    return;
+  }
+
+  // pipe or terminal: nothing to map, so read it all
+  const size_t chunk = 1 << 16;
+  ssize_t got;
+  do {
+    size_t old = m_buffer.size();
+    m_buffer.resize(old + chunk);
+    got = read(fd, m_buffer.data() + old, chunk);
+    if (got < 0 && errno == EINTR) {
+      m_buffer.resize(old);
+      continue;
+    }
+    if (got < 0)
+      throw std::system_error(errno, std::generic_category(), "read");
+    m_buffer.resize(old + got);
+  } while (got != 0);
+
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
@@ -0,0 +1,131 @@
+#include "MessageCache.h"
+#include "formatters.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+MessageCache::MessageCache(size_t capacity, bool withText)
+    : m_withText(withText), m_entries(capacity ? capacity : 1), m_used(0),
+      m_head(NONE), m_tail(NONE) {
+  m_index.reserve(m_entries.size());
+}
+
+void MessageCache::Unlink(uint32_t index) {
+  entry_t &it = m_entries[index];
+  if (it.prev != NONE)
+    m_entries[it.prev].next = it.next;
+  else
+    m_head = it.next;
+  if (it.next != NONE)
+    m_entries[it.next].prev = it.prev;
+  else
+    m_tail = it.prev;
+}
+
+void MessageCache::PushFront(uint32_t index) {
+  entry_t &it = m_entries[index];
+  it.prev = NONE;
+  it.next = m_head;
+  if (m_head != NONE)
+    m_entries[m_head].prev = index;
+  m_head = index;
+  if (m_tail == NONE)
+    m_tail = index;
+}
+
+void MessageCache::PatchId(entry_t &entry, uint16_t id) {
+  entry.value.Message.Header.ID = id;
+  if (!m_withText || entry.idOffset == std::string::npos)
+    return;
+  char digits[8];
+  size_t length = snprintf(digits, sizeof(digits), "%u", id);
+  entry.value.Text.replace(entry.idOffset, entry.idLength, digits, length);
+  entry.idLength = length;
+}
+
+const cached_message_t *MessageCache::Get(const uint8_t *message,
+                                          size_t size, const char **error) {
+  if (error)
+    *error = nullptr;
+  if (size < sizeof(uint16_t)) {
+    if (error)
+      *error = "could not parse dns header";
+    m_stats.Malformed++;
+    return nullptr;
+  }
+  uint16_t id = (message[0] << 8) | message[1];
+  const uint8_t *key = message + sizeof(uint16_t);
+  size_t keySize = size - sizeof(uint16_t);
+  uint64_t hash = hash_bytes(key, keySize);
+
+  auto found = m_index.find(hash);
+  if (found != m_index.end()) {
+    entry_t &it = m_entries[found->second];
+    if (it.key.size() == keySize &&
+        std::memcmp(it.key.data(), key, keySize) == 0) {
+      m_stats.Hits++;
+      Unlink(found->second);
+      PushFront(found->second);
+      PatchId(it, id);
+      return &it.value;
+    }
+  }
+
+  // parse into a free or the least recently used entry, reusing its storage
+  uint32_t index;
+  if (found != m_index.end()) {
+    // same hash, different message: replace it
+    index = found->second;
+    Unlink(index);
+  } else if (m_used < m_entries.size()) {
+    index = m_used++;
+  } else {
+    index = m_tail;
+    Unlink(index);
+    // malformed messages leave unindexed entries at the tail
+    auto evicted = m_index.find(m_entries[index].hash);
+    if (evicted != m_index.end() && evicted->second == index) {
+      m_index.erase(evicted);
+      m_stats.Evictions++;
+    }
+  }
+  m_index[hash] = index;
+
+  entry_t &it = m_entries[index];
+  m_parser.Reset(message, size);
+  if (!m_parser.TryGetDnsMessageValue(it.value.Message, error)) {
+    m_index.erase(hash);
+    it.key.clear();
+    it.hash = 0;
+    // put it at the tail: it's the first to be reused
+    it.prev = m_tail;
+    it.next = NONE;
+    if (m_tail != NONE)
+      m_entries[m_tail].next = index;
+    m_tail = index;
+    if (m_head == NONE)
+      m_head = index;
+    m_stats.Malformed++;
+    return nullptr;
+  }
+  m_stats.Misses++;
+
+  it.hash = hash;
+  it.key.assign(key, key + keySize);
+  if (m_withText) {
+    std::stringstream ss;
+    ss << it.value.Message;
+    it.value.Text = ss.str();
+    // see operator<<(std::ostream &, header_t)
+    const char marker[] = "; id: ";
+    it.idOffset = it.value.Text.find(marker);
+    it.idLength = 0;
+    if (it.idOffset != std::string::npos) {
+      it.idOffset += sizeof(marker) - 1;
+      it.idLength = std::to_string(id).size();
+    }
+  }
+  PushFront(index);
+  return &it.value;
+}
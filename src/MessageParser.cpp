@@ -1,6 +1,7 @@
 #include "MessageParser.h"
 #include "RDataFactory.h"
 #include "dns_constants.h"
+#include <algorithm>
 #include <cstring>
 
 // could be linux/windows C-functions, but platform is unspecified in task,
@@ -24,14 +25,48 @@ uint32_t ntoh(uint32_t net) {
   return net;
 #endif
 }
+MessageParser::MessageParser()
+    : m_offset(0), m_data(nullptr), m_size(0), m_throwing(true),
+      m_error(nullptr), m_foldQName(false), m_foldHashOnly(false) {}
+
 MessageParser::MessageParser(std::vector<uint8_t> &&message)
-    : m_offset(0), m_raw_data(message) {}
+    : m_offset(0), m_raw_data(std::move(message)), m_data(m_raw_data.data()),
+      m_size(m_raw_data.size()), m_throwing(true), m_error(nullptr),
+      m_foldQName(false), m_foldHashOnly(false) {}
+
+MessageParser::MessageParser(const uint8_t *message, size_t size)
+    : m_offset(0), m_data(message), m_size(size), m_throwing(true),
+      m_error(nullptr), m_foldQName(false), m_foldHashOnly(false) {}
+
+void MessageParser::Fail(const char *reason) {
+  if (m_throwing)
+    throw std::invalid_argument(reason);
+  if (!m_error)
+    m_error = reason;
+  m_offset = m_size;
+}
+
+void MessageParser::Reset(std::vector<uint8_t> &&message) {
+  m_raw_data = std::move(message);
+  m_data = m_raw_data.data();
+  m_size = m_raw_data.size();
+  m_offset = 0;
+  m_error = nullptr;
+}
+
+void MessageParser::Reset(const uint8_t *message, size_t size) {
+  m_raw_data.clear();
+  m_data = message;
+  m_size = size;
+  m_offset = 0;
+  m_error = nullptr;
+}
 
 header_t MessageParser::GetHeader() {
-  header_t ret;
-  if (m_raw_data.size() < sizeof(uint16_t) * 6) {
-    std::string errMsg("could not parse dns header");
-    throw std::invalid_argument(errMsg);
+  header_t ret = {};
+  if (m_size < sizeof(uint16_t) * 6) {
+    Fail("could not parse dns header");
+    return ret;
   }
 
   ret.ID = Get<uint16_t>();
@@ -56,64 +91,121 @@ header_t MessageParser::GetHeader() {
 }
 
 std::string MessageParser::GetDomainName(bool couldBeCompressed) {
-  char domain[MAX_NAME_LENGTH + 1];
+  std::string ret;
+  GetDomainName(ret, couldBeCompressed);
+  return ret;
+}
+
+void MessageParser::GetDomainName(std::string &ret, bool couldBeCompressed) {
+  DecodeDomainName(ret, nullptr, false, couldBeCompressed);
+}
+
+void MessageParser::GetDomainName(std::string &ret, folded_name_t &folded,
+                                  bool couldBeCompressed) {
+  DecodeDomainName(ret, &folded, false, couldBeCompressed);
+}
+
+void MessageParser::DecodeDomainName(std::string &ret, folded_name_t *folded,
+                                     bool hashOnly, bool couldBeCompressed) {
+  // labels are copied 16 bytes at a time, see fold_label
+  char domain[MAX_NAME_LENGTH + 16];
+  char lower[MAX_NAME_LENGTH + 16];
   size_t dOffset = 0;
-  domain[dOffset] = 0;
+  // lowercase is hashed by words as soon as they are written
+  uint64_t hash = HASH_SEED;
+  size_t hashed = 0;
+  bool hostname = true;
 
-  size_t lSize;
+  size_t lSize = 1; // name starting out of bound is cut too
   bool compressed = false;
+  size_t hops = 0;
 
   size_t offset = m_offset;
-  uint8_t *data = m_raw_data.data();
+  size_t landing = m_offset;
+  const uint8_t *data = m_data;
 
-  while ((offset < m_raw_data.size()) && ((lSize = data[offset]) != 0)) {
+  while ((offset < m_size) && ((lSize = data[offset]) != 0)) {
     if ((lSize & 0xC0) == 0xC0) {
       if (!couldBeCompressed)
-        throw std::invalid_argument(
-            "it shouldn't be compressed"); // rfc-2782...
+        return Fail("it shouldn't be compressed"); // rfc-2782...
+      if (++hops > MAX_POINTER_HOPS)
+        return Fail("too many compression pointers");
       if (!compressed)
         m_offset += 1;
       compressed = true;
-      if (offset + 1 >= m_raw_data.size())
-        throw std::invalid_argument("out of bound");
-      offset = ((data[offset] & 0x3f) << 8) | data[offset + 1];
-      if (offset >= m_raw_data.size())
-        throw std::invalid_argument("out of bound");
+      if (offset + 1 >= m_size)
+        return Fail("out of bound");
+      size_t pointer = ((data[offset] & 0x3f) << 8) | data[offset + 1];
+      // rfc-1035: pointer to a prior occurance. Just before the pointer isn't
+      // enough: label at 12 and pointer at 14 -> 12 is a loop. Every target
+      // in [landing, pointer) leads to the same pointer again, so it should
+      // go before where the previous jump landed (name start for the first)
+      if (pointer >= landing)
+        return Fail("compression pointer doesn't point back");
+      offset = pointer;
+      landing = pointer;
     } else {
+      if (lSize & 0xC0)
+        return Fail("unsupported label type");
       offset++;
-      if (offset + lSize > m_raw_data.size())
-        throw std::invalid_argument("out of bound");
+      if (offset + lSize > m_size)
+        return Fail("out of bound");
       if (dOffset + lSize + 2 > MAX_NAME_LENGTH)
-        throw std::invalid_argument("too long domain name");
+        return Fail("too long domain name");
 
-      std::memcpy(domain + dOffset, data + offset, lSize);
+      hostname &=
+          fold_label(data + offset, lSize, m_size - offset, domain + dOffset,
+                     folded ? lower + dOffset : nullptr, !hashOnly);
       offset += lSize;
       dOffset += lSize;
-
       domain[dOffset] = '.';
+      lower[dOffset] = '.';
       dOffset++;
-      domain[dOffset] = 0;
+
+      if (folded) {
+        const uint8_t *words = reinterpret_cast<const uint8_t *>(lower);
+        for (; hashed + 8 <= dOffset; hashed += 8)
+          hash = hash_step(hash, words + hashed);
+      }
 
       if (!compressed)
         m_offset = offset;
     }
   }
-  if ( offset == m_raw_data.size() && lSize != 0 )
-  {
-        throw std::invalid_argument("looks like message cut");
+  if (offset >= m_size && lSize != 0) {
+    return Fail("looks like message cut");
   }
   m_offset++;
-  return domain;
+  ret.assign(domain, dOffset);
+  if (folded) {
+    folded->Hash = hash_finish(
+        hash, reinterpret_cast<const uint8_t *>(lower) + hashed, dOffset);
+    folded->HashOnly = hashOnly;
+    if (hashOnly) {
+      folded->Lowercase.clear();
+      folded->Hostname = false;
+    } else {
+      folded->Lowercase.assign(lower, dOffset);
+      folded->Hostname = hostname;
+    }
+  }
 }
-
 question_t MessageParser::GetQuestion() {
   question_t ret;
+  GetQuestion(ret);
+  return ret;
+}
 
-  ret.QNAME = GetDomainName();
+void MessageParser::GetQuestion(question_t &ret) {
+  GetDomainName(ret.QNAME);
   ret.QTYPE = Get<uint16_t>();
   ret.QCLASS = Get<uint16_t>();
+}
 
-  return ret;
+void MessageParser::GetQuestion(question_t &ret, folded_name_t &folded) {
+  DecodeDomainName(ret.QNAME, &folded, m_foldHashOnly, true);
+  ret.QTYPE = Get<uint16_t>();
+  ret.QCLASS = Get<uint16_t>();
 }
 
 resource_record_t MessageParser::GetResourceRecord() {
@@ -130,15 +222,23 @@ resource_record_t MessageParser::GetResourceRecord() {
 }
 
 std::vector<uint8_t> MessageParser::GetRawData(size_t length) {
-  if ((m_offset + length) > m_raw_data.size())
-    throw std::invalid_argument("out of bound");
-  std::vector<uint8_t> ret(m_raw_data.begin() + m_offset,
-                           m_raw_data.begin() + m_offset + length);
+  if ((m_offset + length) > m_size) {
+    Fail("out of bound");
+    return {};
+  }
+  std::vector<uint8_t> ret(m_data + m_offset, m_data + m_offset + length);
 
   m_offset += length;
   return ret;
 }
 
+void MessageParser::GetRawData(uint8_t *dst, size_t length) {
+  if ((m_offset + length) > m_size)
+    return Fail("out of bound");
+  std::memcpy(dst, m_data + m_offset, length);
+  m_offset += length;
+}
+
 // https://www.cloudflare.com/learning/dns/dns-records/
 // I guess, it's enough to implement commonly-used subset and print hex for
 // other things... +AAAA, which is hidden in A.
@@ -158,25 +258,310 @@ std::unique_ptr<RData> MessageParser::GetRData(uint16_t type) {
   return std::unique_ptr<RData>(ret);
 }
 
+// counts come from the wire, don't let 0xFFFF in a 20-byte message reserve
+// megabytes: every entry takes at least minSize bytes
+size_t MessageParser::GetReserveLimit(uint16_t count, size_t minSize) {
+  size_t left = m_size - m_offset;
+  return std::min<size_t>(count, left / minSize);
+}
+
 dns_message_t MessageParser::GetDnsMessage() {
   dns_message_t ret;
   ret.Header = GetHeader();
-  if (ret.Header.QDCOUNT > 0) {
-    for (int i = 0; i < ret.Header.QDCOUNT; i++)
-      ret.Question.push_back(GetQuestion());
-  }
-  if (ret.Header.ANCOUNT > 0) {
-    for (int i = 0; i < ret.Header.ANCOUNT; i++)
-      ret.Answer.push_back(GetResourceRecord());
+
+  ret.Question.reserve(GetReserveLimit(ret.Header.QDCOUNT, MIN_QUESTION_SIZE));
+  for (int i = 0; i < ret.Header.QDCOUNT; i++)
+    ret.Question.push_back(GetQuestion());
+
+  ret.Answer.reserve(
+      GetReserveLimit(ret.Header.ANCOUNT, MIN_RESOURCE_RECORD_SIZE));
+  for (int i = 0; i < ret.Header.ANCOUNT; i++)
+    ret.Answer.push_back(GetResourceRecord());
+
+  ret.Authority.reserve(
+      GetReserveLimit(ret.Header.NSCOUNT, MIN_RESOURCE_RECORD_SIZE));
+  for (int i = 0; i < ret.Header.NSCOUNT; i++)
+    ret.Authority.push_back(GetResourceRecord());
+
+  ret.Additional.reserve(
+      GetReserveLimit(ret.Header.ARCOUNT, MIN_RESOURCE_RECORD_SIZE));
+  for (int i = 0; i < ret.Header.ARCOUNT; i++)
+    ret.Additional.push_back(GetResourceRecord());
+
+  return ret;
+}
+
+resource_record_value_t MessageParser::GetResourceRecordValue() {
+  resource_record_value_t ret;
+  GetResourceRecordValue(ret);
+  return ret;
+}
+
+void MessageParser::GetResourceRecordValue(resource_record_value_t &ret) {
+  GetDomainName(ret.NAME);
+
+  ret.TYPE = Get<uint16_t>();
+  ret.CLASS = Get<uint16_t>();
+  ret.TTL = Get<uint32_t>();
+
+  GetRDataValue(ret.TYPE, ret.RDATA);
+}
+
+rdata_value_t MessageParser::GetRDataValue(uint16_t type) {
+  rdata_value_t ret;
+  GetRDataValue(type, ret);
+  return ret;
+}
+
+// keep alternative if it's already there: its strings have capacity. Otherwise
+// the old one goes to the pool of its type and T is taken from its own pool,
+// so records changing type from message to message don't allocate
+template <typename T> T &MessageParser::RDataAs(rdata_value_t &rdata) {
+  if (T *ret = std::get_if<T>(&rdata))
+    return *ret;
+  if (!rdata.valueless_by_exception())
+    std::visit(
+        [this](auto &old) {
+          using U = std::decay_t<decltype(old)>;
+          m_spareRData.Get<U>().push_back(std::move(old));
+        },
+        rdata);
+  std::vector<T> &pool = m_spareRData.Get<T>();
+  if (pool.empty())
+    return rdata.emplace<T>();
+  T &ret = rdata.emplace<T>(std::move(pool.back()));
+  pool.pop_back();
+  return ret;
+}
+
+// same set of types as RDataFactory knows, but without heap allocation
+void MessageParser::GetRDataValue(uint16_t type, rdata_value_t &ret) {
+  uint16_t RDLENGTH = Get<uint16_t>();
+
+  switch (type) {
+  case TYPE_A:
+    return a_rdata_t::Parse(*this, RDLENGTH, RDataAs<a_rdata_t>(ret));
+  case TYPE_AAAA:
+    return aaaa_rdata_t::Parse(*this, RDLENGTH, RDataAs<aaaa_rdata_t>(ret));
+  case TYPE_NS:
+  case TYPE_CNAME:
+  case TYPE_PTR:
+    return domain_rdata_t::Parse(*this, RDLENGTH,
+                                 RDataAs<domain_rdata_t>(ret));
+  case TYPE_MX:
+    return mx_rdata_t::Parse(*this, RDLENGTH, RDataAs<mx_rdata_t>(ret));
+  case TYPE_TXT:
+    return txt_rdata_t::Parse(*this, RDLENGTH, RDataAs<txt_rdata_t>(ret));
+  case TYPE_SOA:
+    return soa_rdata_t::Parse(*this, RDLENGTH, RDataAs<soa_rdata_t>(ret));
+  case TYPE_SRV:
+    return srv_rdata_t::Parse(*this, RDLENGTH, RDataAs<srv_rdata_t>(ret));
+  default:
+    return generic_rdata_t::Parse(*this, RDLENGTH,
+                                  RDataAs<generic_rdata_t>(ret));
   }
+}
+
+static void get_entry(MessageParser &mp, question_t &ret,
+                      folded_name_t *folded) {
+  if (folded)
+    mp.GetQuestion(ret, *folded);
+  else
+    mp.GetQuestion(ret);
+}
 
-  if (ret.Header.NSCOUNT > 0) {
-    for (int i = 0; i < ret.Header.NSCOUNT; i++)
-      ret.Authority.push_back(GetResourceRecord());
+static void get_entry(MessageParser &mp, resource_record_value_t &ret,
+                      folded_name_t *) {
+  mp.GetResourceRecordValue(ret);
+}
+
+// entries are parsed over existing ones. extra entries are moved to spare
+// instead of destruction, missing ones are taken from spare. After a failure
+// the rest of counts isn't walked: section is cut to what was parsed.
+// foldFirst gets folded name of the first entry, if given
+template <typename T>
+void MessageParser::GetSection(std::vector<T> &section, uint16_t count,
+                               size_t minSize, std::vector<T> &spare,
+                               folded_name_t *foldFirst) {
+  section.reserve(GetReserveLimit(count, minSize));
+  for (size_t i = 0; i < count; i++) {
+    if (m_error) {
+      count = i;
+      break;
+    }
+    if (i == section.size()) {
+      if (spare.empty()) {
+        section.emplace_back();
+      } else {
+        section.push_back(std::move(spare.back()));
+        spare.pop_back();
+      }
+    }
+    get_entry(*this, section[i], i ? nullptr : foldFirst);
   }
-  if (ret.Header.ARCOUNT > 0) {
-    for (int i = 0; i < ret.Header.ARCOUNT; i++)
-      ret.Additional.push_back(GetResourceRecord());
+  while (section.size() > count) {
+    spare.push_back(std::move(section.back()));
+    section.pop_back();
   }
+}
+
+dns_message_value_t MessageParser::GetDnsMessageValue() {
+  dns_message_value_t ret;
+  GetDnsMessageValue(ret);
   return ret;
 }
+
+void MessageParser::GetDnsMessageValue(dns_message_value_t &ret) {
+  ret.Header = GetHeader();
+  GetSection(ret.Question, ret.Header.QDCOUNT, MIN_QUESTION_SIZE,
+             m_spareQuestions, m_foldQName ? &ret.FoldedQNAME : nullptr);
+  ret.HasFoldedQNAME = m_foldQName && !ret.Question.empty();
+  GetSection(ret.Answer, ret.Header.ANCOUNT, MIN_RESOURCE_RECORD_SIZE,
+             m_spareAnswer);
+  GetSection(ret.Authority, ret.Header.NSCOUNT, MIN_RESOURCE_RECORD_SIZE,
+             m_spareAuthority);
+  GetSection(ret.Additional, ret.Header.ARCOUNT, MIN_RESOURCE_RECORD_SIZE,
+             m_spareAdditional);
+}
+
+// same walk as GetDomainName, but without copying and exceptions
+const char *skip_domain_name(const uint8_t *data, size_t size, size_t &offset,
+                             bool couldBeCompressed) {
+  size_t current = offset;
+  size_t landing = offset;
+  size_t next = 0;
+  size_t length = 0;
+  size_t hops = 0;
+  while (true) {
+    if (current >= size)
+      return "looks like message cut";
+    size_t lSize = data[current];
+    if (lSize == 0) {
+      offset = next ? next : current + 1;
+      return nullptr;
+    }
+    if ((lSize & 0xC0) == 0xC0) {
+      if (!couldBeCompressed)
+        return "it shouldn't be compressed";
+      if (++hops > MAX_POINTER_HOPS)
+        return "too many compression pointers";
+      if (current + 1 >= size)
+        return "out of bound";
+      if (!next)
+        next = current + 2;
+      size_t pointer = ((lSize & 0x3f) << 8) | data[current + 1];
+      if (pointer >= landing)
+        return "compression pointer doesn't point back";
+      current = pointer;
+      landing = pointer;
+      continue;
+    }
+    if (lSize & 0xC0)
+      return "unsupported label type";
+    if (current + 1 + lSize > size)
+      return "out of bound";
+    if (length + lSize + 2 > MAX_NAME_LENGTH)
+      return "too long domain name";
+    length += lSize + 1;
+    current += lSize + 1;
+  }
+}
+
+const char *skip_rdata(const uint8_t *data, size_t size, size_t &offset,
+                       uint16_t type, size_t RDLENGTH) {
+  const char *error = nullptr;
+  size_t end = offset + RDLENGTH;
+  switch (type) {
+  case TYPE_A:
+    if (RDLENGTH != 4)
+      return "wrong rdata size for A record";
+    break;
+  case TYPE_AAAA:
+    if (RDLENGTH != 16)
+      return "wrong rdata size for AAAA record";
+    break;
+  case TYPE_NS:
+  case TYPE_CNAME:
+  case TYPE_PTR:
+    error = skip_domain_name(data, size, offset, true);
+    break;
+  case TYPE_MX:
+    offset += 2;
+    error = skip_domain_name(data, size, offset, true);
+    break;
+  case TYPE_SOA:
+    error = skip_domain_name(data, size, offset, true);
+    if (!error)
+      error = skip_domain_name(data, size, offset, true);
+    offset += 5 * sizeof(uint32_t);
+    break;
+  case TYPE_SRV:
+    offset += 3 * sizeof(uint16_t);
+    error = skip_domain_name(data, size, offset, false);
+    break;
+  default:
+    offset = end;
+    break;
+  }
+  if (error)
+    return error;
+  if (offset != end && type != TYPE_A && type != TYPE_AAAA)
+    return "RDATA format error ";
+  if (end > size)
+    return "out of bound";
+  offset = end;
+  return nullptr;
+}
+
+const char *MessageParser::CheckDnsMessage() const {
+  const size_t headerSize = sizeof(uint16_t) * 6;
+  if (m_size < headerSize)
+    return "could not parse dns header";
+
+  auto get16 = [this](size_t at) -> uint16_t {
+    return (m_data[at] << 8) | m_data[at + 1];
+  };
+  uint16_t qdcount = get16(4);
+  uint32_t rrcount = (uint32_t)get16(6) + get16(8) + get16(10);
+
+  size_t offset = headerSize;
+  const char *error;
+  for (uint16_t i = 0; i < qdcount; i++) {
+    if ((error = skip_domain_name(m_data, m_size, offset, true)))
+      return error;
+    offset += 2 * sizeof(uint16_t);
+    if (offset > m_size)
+      return "out of bound";
+  }
+  for (uint32_t i = 0; i < rrcount; i++) {
+    if ((error = skip_domain_name(m_data, m_size, offset, true)))
+      return error;
+    if (offset + 10 > m_size)
+      return "out of bound";
+    uint16_t type = get16(offset);
+    uint16_t RDLENGTH = get16(offset + 8);
+    offset += 10;
+    if ((error = skip_rdata(m_data, m_size, offset, type, RDLENGTH)))
+      return error;
+  }
+  return nullptr;
+}
+
+// one pass: Fail records the reason instead of throwing. bad_alloc and such
+// still get through
+bool MessageParser::TryGetDnsMessageValue(dns_message_value_t &ret,
+                                          const char **error) {
+  m_offset = 0;
+  m_error = nullptr;
+  m_throwing = false;
+  try {
+    GetDnsMessageValue(ret);
+  } catch (...) {
+    m_throwing = true;
+    throw;
+  }
+  m_throwing = true;
+  if (error)
+    *error = m_error;
+  return !m_error;
+}
@@ -0,0 +1,220 @@
+#include "QueryMatcher.h"
+
+#include <cstring>
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+  // splitmix64 finalizer
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+static uint64_t hash_flow(const flow_t &flow) {
+  uint64_t words[4];
+  std::memcpy(words, flow.SrcAddress.data(), 16);
+  std::memcpy(words + 2, flow.DstAddress.data(), 16);
+  uint64_t hash = 0;
+  for (uint64_t it : words)
+    hash = mix(hash, it);
+  return mix(hash, (uint64_t)flow.SrcPort << 16 | flow.DstPort);
+}
+
+static bool same_flow(const flow_t &a, const flow_t &b) {
+  return a.SrcPort == b.SrcPort && a.DstPort == b.DstPort &&
+         a.SrcAddress == b.SrcAddress && a.DstAddress == b.DstAddress;
+}
+
+QueryMatcher::QueryMatcher(uint64_t timeout, size_t capacity, Handler handler,
+                           uint64_t tick)
+    : m_timeout(timeout), m_tick(tick ? tick : 1), m_currentTick(0),
+      m_handler(handler), m_entries(capacity) {
+  m_free.reserve(capacity);
+  for (size_t i = capacity; i > 0; i--)
+    m_free.push_back(i - 1);
+
+  // at most half full: probe sequences stay short
+  size_t slots = 1;
+  while (slots < capacity * 2)
+    slots <<= 1;
+  m_slots.assign(slots, NONE);
+
+  // live entries expire within (current, current + timeout / tick + 1]
+  m_wheel.assign((m_timeout + m_tick - 1) / m_tick + 2, NONE);
+}
+
+void QueryMatcher::OnMessage(const dns_message_value_t &dm, const flow_t &flow,
+                             uint64_t time) {
+  Advance(time);
+
+  if (dm.Question.empty()) {
+    m_stats.Ignored++;
+    return;
+  }
+
+  entry_t key;
+  key.qnameHash = dm.HasFoldedQNAME ? dm.FoldedQNAME.Hash
+                                    : hash_domain_name(dm.Question[0].QNAME);
+  key.qtype = dm.Question[0].QTYPE;
+  key.id = dm.Header.ID;
+  key.flow = flow;
+  if (dm.Header.QR) {
+    // response goes from server to client
+    key.flow.SrcAddress = flow.DstAddress;
+    key.flow.DstAddress = flow.SrcAddress;
+    key.flow.SrcPort = flow.DstPort;
+    key.flow.DstPort = flow.SrcPort;
+  }
+  key.hash = mix(mix(hash_flow(key.flow), key.qnameHash),
+                 (uint64_t)key.id << 16 | key.qtype);
+  key.time = time;
+
+  if (dm.Header.QR)
+    OnResponse(key, time);
+  else
+    OnQuery(key);
+}
+
+uint32_t QueryMatcher::Find(const entry_t &key, size_t &slot) const {
+  size_t mask = m_slots.size() - 1;
+  for (slot = key.hash & mask; m_slots[slot] != NONE;
+       slot = (slot + 1) & mask) {
+    const entry_t &it = m_entries[m_slots[slot]];
+    if (it.hash == key.hash && it.id == key.id && it.qtype == key.qtype &&
+        it.qnameHash == key.qnameHash && same_flow(it.flow, key.flow))
+      return m_slots[slot];
+  }
+  return NONE;
+}
+
+void QueryMatcher::OnQuery(const entry_t &query) {
+  m_stats.Queries++;
+
+  size_t slot;
+  if (Find(query, slot) != NONE) {
+    m_stats.Duplicates++;
+    return;
+  }
+  if (m_free.empty()) {
+    m_stats.Overflows++;
+    return;
+  }
+
+  uint32_t index = m_free.back();
+  m_free.pop_back();
+  m_slots[slot] = index;
+
+  entry_t &it = m_entries[index];
+  it = query;
+  it.expireTick = (query.time + m_timeout + m_tick - 1) / m_tick;
+  if (it.expireTick <= m_currentTick)
+    it.expireTick = m_currentTick + 1;
+
+  uint32_t &head = m_wheel[it.expireTick % m_wheel.size()];
+  it.wheelPrev = NONE;
+  it.wheelNext = head;
+  if (head != NONE)
+    m_entries[head].wheelPrev = index;
+  head = index;
+}
+
+void QueryMatcher::OnResponse(const entry_t &response, uint64_t time) {
+  m_stats.Responses++;
+
+  size_t slot;
+  uint32_t index = Find(response, slot);
+  if (index == NONE) {
+    m_stats.UnmatchedResponses++;
+    return;
+  }
+
+  const entry_t &query = m_entries[index];
+  m_stats.Matched++;
+  Report(index, time > query.time ? time - query.time : 0, false);
+  Remove(slot);
+}
+
+void QueryMatcher::Report(uint32_t index, uint64_t latency, bool timedOut) {
+  const entry_t &it = m_entries[index];
+  match_t match;
+  match.ID = it.id;
+  match.QTYPE = it.qtype;
+  match.QNameHash = it.qnameHash;
+  match.Flow = it.flow;
+  match.QueryTime = it.time;
+  match.Latency = latency;
+  match.TimedOut = timedOut;
+  if (m_handler)
+    m_handler(match);
+}
+
+// unlinks entry from table (backward shift deletion, no tombstones) and
+// wheel, returns it to free list
+void QueryMatcher::Remove(size_t slot) {
+  uint32_t index = m_slots[slot];
+  entry_t &it = m_entries[index];
+
+  if (it.wheelPrev != NONE)
+    m_entries[it.wheelPrev].wheelNext = it.wheelNext;
+  else
+    m_wheel[it.expireTick % m_wheel.size()] = it.wheelNext;
+  if (it.wheelNext != NONE)
+    m_entries[it.wheelNext].wheelPrev = it.wheelPrev;
+
+  size_t mask = m_slots.size() - 1;
+  size_t hole = slot;
+  for (size_t next = (hole + 1) & mask; m_slots[next] != NONE;
+       next = (next + 1) & mask) {
+    size_t ideal = m_entries[m_slots[next]].hash & mask;
+    // entry could move to the hole if hole is between ideal and next
+    if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+      m_slots[hole] = m_slots[next];
+      hole = next;
+    }
+  }
+  m_slots[hole] = NONE;
+
+  m_free.push_back(index);
+}
+
+void QueryMatcher::Advance(uint64_t time) {
+  uint64_t nowTick = time / m_tick;
+  if (nowTick <= m_currentTick)
+    return;
+
+  // after a long pause every slot is visited once, not every tick
+  uint64_t from = m_currentTick + 1;
+  if (nowTick - m_currentTick > m_wheel.size())
+    from = nowTick - m_wheel.size() + 1;
+
+  for (uint64_t tick = from; tick <= nowTick; tick++) {
+    uint32_t index = m_wheel[tick % m_wheel.size()];
+    while (index != NONE) {
+      uint32_t next = m_entries[index].wheelNext;
+      if (m_entries[index].expireTick <= nowTick) {
+        size_t slot;
+        Find(m_entries[index], slot);
+        m_stats.TimedOut++;
+        Report(index, 0, true);
+        Remove(slot);
+      }
+      index = next;
+    }
+  }
+  m_currentTick = nowTick;
+}
+
+void QueryMatcher::Flush() {
+  for (uint32_t &head : m_wheel) {
+    while (head != NONE) {
+      size_t slot;
+      Find(m_entries[head], slot);
+      m_stats.TimedOut++;
+      Report(head, 0, true);
+      Remove(slot); // moves head forward
+    }
+  }
+}
@@ -0,0 +1,163 @@
+#include "MessageParser.h"
+#include "RDataValue.h"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+void a_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH, a_rdata_t &ret) {
+  if (RDLENGTH != ret.ADDRESS.size())
+    return mp.Fail("wrong rdata size for A record");
+  mp.GetRawData(ret.ADDRESS.data(), ret.ADDRESS.size());
+}
+
+a_rdata_t::operator std::string() const {
+  std::stringstream ss;
+  for (size_t i = 0; i < ADDRESS.size(); i++)
+    ss << (int)ADDRESS[i] << ((i != ADDRESS.size() - 1) ? "." : "");
+  return ss.str();
+}
+
+void aaaa_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH,
+                         aaaa_rdata_t &ret) {
+  if (RDLENGTH != ret.ADDRESS.size())
+    return mp.Fail("wrong rdata size for AAAA record");
+  mp.GetRawData(ret.ADDRESS.data(), ret.ADDRESS.size());
+}
+
+aaaa_rdata_t::operator std::string() const {
+  std::stringstream ss;
+
+  ss.setf(std::ios_base::hex, std::ios_base::basefield);
+  // could be improved with replacing zeros with :: and remove leading
+  // zeros...
+  for (size_t i = 0; i < ADDRESS.size(); i += 2)
+    ss << std::setw(2) << std::setfill('0') << (int)ADDRESS[i] << std::setw(2)
+       << std::setfill('0') << (int)ADDRESS[i + 1]
+       << ((i != ADDRESS.size() - 2) ? ":" : "");
+
+  ss.unsetf(std::ios_base::hex);
+  return ss.str();
+}
+
+void domain_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH,
+                           domain_rdata_t &ret) {
+  size_t offsetBefore = mp.GetCurrentOffset();
+
+  mp.GetDomainName(ret.DOMAIN);
+  size_t offsetAfter = mp.GetCurrentOffset();
+
+  //  RAII-offset-checker wouldn't work - we couldn't throw from destructor
+  //  :-(
+  if (offsetAfter - offsetBefore != RDLENGTH)
+    return mp.Fail("RDLENGTH not equial to domain name");
+}
+
+domain_rdata_t::operator std::string() const { return DOMAIN; }
+
+void mx_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH, mx_rdata_t &ret) {
+  size_t offsetBefore = mp.GetCurrentOffset();
+
+  ret.PREFERENCE = mp.Get<uint16_t>();
+  mp.GetDomainName(ret.EXCHANGE);
+
+  size_t offsetAfter = mp.GetCurrentOffset();
+  if (offsetAfter - offsetBefore != RDLENGTH)
+    return mp.Fail("RDATA format error ");
+}
+
+mx_rdata_t::operator std::string() const {
+  return std::to_string(PREFERENCE) + " " + EXCHANGE;
+}
+
+void txt_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH, txt_rdata_t &ret) {
+  // cut message shouldn't make string grow
+  if (mp.GetCurrentOffset() + RDLENGTH > mp.GetSize())
+    return mp.Fail("out of bound");
+  ret.TXT.resize(RDLENGTH);
+  mp.GetRawData(reinterpret_cast<uint8_t *>(&ret.TXT[0]), RDLENGTH);
+}
+
+txt_rdata_t::operator std::string() const { return TXT; }
+
+void soa_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH, soa_rdata_t &ret) {
+  size_t offsetBefore = mp.GetCurrentOffset();
+  mp.GetDomainName(ret.MNAME);
+  mp.GetDomainName(ret.RNAME);
+  ret.SERIAL = mp.Get<uint32_t>();
+  ret.REFRESH = mp.Get<uint32_t>();
+  ret.RETRY = mp.Get<uint32_t>();
+  ret.EXPIRE = mp.Get<uint32_t>();
+  ret.MINIMUM = mp.Get<uint32_t>();
+
+  size_t offsetAfter = mp.GetCurrentOffset();
+  if (offsetAfter - offsetBefore != RDLENGTH)
+    return mp.Fail("RDATA format error ");
+}
+
+soa_rdata_t::operator std::string() const {
+  return MNAME + " " + RNAME + " " + std::to_string(SERIAL) + " " +
+         std::to_string(REFRESH) + " " + std::to_string(RETRY) + " " +
+         std::to_string(EXPIRE) + " " + std::to_string(MINIMUM);
+}
+
+void srv_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH, srv_rdata_t &ret) {
+  size_t offsetBefore = mp.GetCurrentOffset();
+  ret.PRIORITY = mp.Get<uint16_t>();
+  ret.WEIGHT = mp.Get<uint16_t>();
+  ret.PORT = mp.Get<uint16_t>();
+
+  const bool couldBeCompressed = false;
+  mp.GetDomainName(ret.TARGET, couldBeCompressed);
+
+  size_t offsetAfter = mp.GetCurrentOffset();
+  if (offsetAfter - offsetBefore != RDLENGTH)
+    return mp.Fail("RDATA format error ");
+}
+
+srv_rdata_t::operator std::string() const {
+  return std::to_string(PRIORITY) + " " + std::to_string(WEIGHT) + " " +
+         std::to_string(PORT) + " " + TARGET;
+}
+
+generic_rdata_t::generic_rdata_t(const uint8_t *data, size_t size)
+    : m_size(size) {
+  if (size <= INLINE_SIZE)
+    std::memcpy(m_inline.data(), data, size);
+  else
+    m_heap.assign(data, data + size);
+}
+
+const uint8_t *generic_rdata_t::data() const {
+  return (m_size <= INLINE_SIZE) ? m_inline.data() : m_heap.data();
+}
+
+void generic_rdata_t::Parse(MessageParser &mp, size_t RDLENGTH,
+                            generic_rdata_t &ret) {
+  if (mp.GetCurrentOffset() + RDLENGTH > mp.GetSize())
+    return mp.Fail("out of bound");
+  ret.m_size = RDLENGTH;
+  if (RDLENGTH <= INLINE_SIZE) {
+    mp.GetRawData(ret.m_inline.data(), RDLENGTH);
+  } else {
+    ret.m_heap.resize(RDLENGTH);
+    mp.GetRawData(ret.m_heap.data(), RDLENGTH);
+  }
+}
+
+generic_rdata_t::operator std::string() const {
+  std::stringstream ss;
+  ss << "unknown rdata(" << size() << ") hex: [";
+  ss.setf(std::ios_base::hex, std::ios_base::basefield);
+  ss.setf(std::ios_base::showbase);
+  for (size_t i = 0; i < size(); i++)
+    ss << (int)data()[i] << " ";
+
+  ss.unsetf(std::ios_base::hex);
+  ss << "]";
+
+  return ss.str();
+}
+
+std::string to_string(const rdata_value_t &rdata) {
+  return std::visit([](const auto &v) { return (std::string)v; }, rdata);
+}
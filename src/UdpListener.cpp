@@ -0,0 +1,274 @@
+#include "UdpListener.h"
+#include "MessageParser.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+BufferPool::BufferPool(size_t count, size_t bufferSize)
+    : m_bufferSize(bufferSize), m_storage(count * bufferSize) {
+  m_free.reserve(count);
+  for (size_t i = 0; i < count; i++)
+    m_free.push_back(m_storage.data() + i * bufferSize);
+}
+
+size_t BufferPool::Acquire(uint8_t **buffers, size_t max) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait(lock, [this] { return !m_free.empty(); });
+  size_t count = 0;
+  while (count < max && !m_free.empty()) {
+    buffers[count++] = m_free.back();
+    m_free.pop_back();
+  }
+  return count;
+}
+
+void BufferPool::Release(uint8_t *buffer) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(buffer);
+  }
+  m_cv.notify_one();
+}
+
+UdpListener::UdpListener(const std::string &address, uint16_t port,
+                         Handler handler, size_t workers, size_t buffers,
+                         size_t bufferSize)
+    : m_socket(-1), m_epoll(-1), m_stopEvent(-1), m_port(port), m_address(0),
+      m_handler(handler), m_workers(workers ? workers : 1), m_foldQName(false),
+      m_foldHashOnly(false),
+      m_pool(buffers, bufferSize), m_queue(buffers), m_queueHead(0),
+      m_queueSize(0), m_stopping(false), m_stopRequested(false) {
+  try {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+      throw std::invalid_argument("wrong listen address " + address);
+
+    m_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (m_socket < 0)
+      throw std::system_error(errno, std::generic_category(), "socket");
+    if (bind(m_socket, (sockaddr *)&addr, sizeof(addr)) != 0)
+      throw std::system_error(errno, std::generic_category(), "bind");
+    // receive time and destination address come with every datagram
+    int on = 1;
+    if (setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) != 0)
+      throw std::system_error(errno, std::generic_category(), "SO_TIMESTAMP");
+    if (setsockopt(m_socket, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) != 0)
+      throw std::system_error(errno, std::generic_category(), "IP_PKTINFO");
+
+    socklen_t len = sizeof(addr);
+    if (getsockname(m_socket, (sockaddr *)&addr, &len) != 0)
+      throw std::system_error(errno, std::generic_category(), "getsockname");
+    m_port = ntohs(addr.sin_port);
+    m_address = addr.sin_addr.s_addr;
+
+    m_stopEvent = eventfd(0, EFD_NONBLOCK);
+    if (m_stopEvent < 0)
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+
+    m_epoll = epoll_create1(0);
+    if (m_epoll < 0)
+      throw std::system_error(errno, std::generic_category(), "epoll_create1");
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_socket;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_socket, &ev) != 0)
+      throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+    ev.data.fd = m_stopEvent;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_stopEvent, &ev) != 0)
+      throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+  } catch (...) {
+    Close();
+    throw;
+  }
+}
+
+UdpListener::~UdpListener() { Close(); }
+
+void UdpListener::Close() {
+  if (m_epoll >= 0)
+    close(m_epoll);
+  if (m_stopEvent >= 0)
+    close(m_stopEvent);
+  if (m_socket >= 0)
+    close(m_socket);
+  m_epoll = m_stopEvent = m_socket = -1;
+}
+
+void UdpListener::Stop() {
+  m_stopRequested = true;
+  uint64_t one = 1;
+  if (write(m_stopEvent, &one, sizeof(one)) < 0) {
+    // counter overflow only, event is signaled anyway
+  }
+}
+
+void UdpListener::Run() {
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < m_workers; i++)
+    workers.emplace_back(&UdpListener::Work, this);
+
+  bool stop = false;
+  while (!stop) {
+    epoll_event events[2];
+    int n = epoll_wait(m_epoll, events, 2, -1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      break;
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == m_stopEvent)
+        stop = true;
+      else
+        ReceiveBatch();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  for (auto &it : workers)
+    it.join();
+
+  uint64_t value;
+  if (read(m_stopEvent, &value, sizeof(value)) < 0) {
+    // nothing to reset
+  }
+  m_stopping = false;
+  m_stopRequested = false;
+}
+
+// sender, destination and receive time of a datagram from recvmmsg
+static datagram_info_t get_info(const msghdr &hdr, uint32_t address,
+                                uint16_t port) {
+  datagram_info_t ret = {};
+  const sockaddr_in *from = static_cast<const sockaddr_in *>(hdr.msg_name);
+  std::memcpy(ret.Flow.SrcAddress.data(), &from->sin_addr, 4);
+  ret.Flow.SrcPort = ntohs(from->sin_port);
+  std::memcpy(ret.Flow.DstAddress.data(), &address, 4);
+  ret.Flow.DstPort = port;
+
+  bool stamped = false;
+  for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+       cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&hdr), cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+      timeval tv;
+      std::memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+      ret.Time = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+      stamped = true;
+    } else if (cmsg->cmsg_level == IPPROTO_IP &&
+               cmsg->cmsg_type == IP_PKTINFO) {
+      in_pktinfo info;
+      std::memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+      std::memcpy(ret.Flow.DstAddress.data(), &info.ipi_addr, 4);
+    }
+  }
+  // control data was cut, clock of the same epoch is the closest
+  if (!stamped)
+    ret.Time = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+  return ret;
+}
+
+// drain socket: recvmmsg fetches up to BATCH_SIZE datagrams per syscall. Stop
+// is checked between batches, under load socket could be never drained
+void UdpListener::ReceiveBatch() {
+  uint8_t *buffers[BATCH_SIZE];
+  iovec iov[BATCH_SIZE];
+  mmsghdr msgs[BATCH_SIZE];
+  sockaddr_in names[BATCH_SIZE];
+  const size_t CONTROL_SIZE =
+      CMSG_SPACE(sizeof(timeval)) + CMSG_SPACE(sizeof(in_pktinfo));
+  alignas(cmsghdr) uint8_t control[BATCH_SIZE][CONTROL_SIZE];
+
+  while (!m_stopRequested) {
+    size_t count = m_pool.Acquire(buffers, BATCH_SIZE);
+    for (size_t i = 0; i < count; i++) {
+      iov[i].iov_base = buffers[i];
+      iov[i].iov_len = m_pool.GetBufferSize();
+      msgs[i] = {};
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &names[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(names[i]);
+      msgs[i].msg_hdr.msg_control = control[i];
+      msgs[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+    }
+
+    int n = recvmmsg(m_socket, msgs, count, MSG_DONTWAIT, nullptr);
+    if (n < 0)
+      n = 0; // EAGAIN: socket is drained
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (int i = 0; i < n; i++) {
+        m_stats.Received++;
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+          m_stats.Truncated++;
+          m_pool.Release(buffers[i]);
+          continue;
+        }
+        // never overflows: there are only m_queue.size() buffers
+        m_queue[(m_queueHead + m_queueSize) % m_queue.size()] = {
+            buffers[i], msgs[i].msg_len,
+            get_info(msgs[i].msg_hdr, m_address, m_port)};
+        m_queueSize++;
+      }
+    }
+    m_cv.notify_all();
+
+    for (size_t i = n; i < count; i++)
+      m_pool.Release(buffers[i]);
+
+    if ((size_t)n < count)
+      return;
+  }
+}
+
+void UdpListener::Work() {
+  // reused for all datagrams of this worker
+  MessageParser mp;
+  mp.SetFoldQName(m_foldQName, m_foldHashOnly);
+  dns_message_value_t dm;
+  while (true) {
+    datagram_t dg;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stopping || m_queueSize != 0; });
+      if (m_queueSize == 0)
+        return;
+      dg = m_queue[m_queueHead];
+      m_queueHead = (m_queueHead + 1) % m_queue.size();
+      m_queueSize--;
+    }
+
+    mp.Reset(dg.buffer, dg.size);
+    bool parsed = mp.TryGetDnsMessageValue(dm);
+    // parsed message doesn't point to buffer, so it could be reused already
+    m_pool.Release(dg.buffer);
+    if (!parsed) {
+      m_stats.Malformed++;
+      continue;
+    }
+    m_stats.Parsed++;
+    // exception would terminate the whole process from worker thread
+    try {
+      m_handler(dm, dg.info);
+    } catch (...) {
+      m_stats.HandlerFailed++;
+    }
+  }
+}
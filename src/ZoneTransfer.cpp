@@ -0,0 +1,326 @@
+#include "ZoneTransfer.h"
+#include "dns_constants.h"
+#include "formatters.h"
+
+#include <algorithm>
+#include <type_traits>
+
+static void append16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(value >> 8);
+  out.push_back(value & 0xff);
+}
+
+static void append32(std::vector<uint8_t> &out, uint32_t value) {
+  append16(out, value >> 16);
+  append16(out, value & 0xffff);
+}
+
+void append_wire_name(std::vector<uint8_t> &out, const std::string &name) {
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('.', start);
+    if (end == std::string::npos)
+      end = name.size();
+    if (end != start) {
+      out.push_back(end - start);
+      out.insert(out.end(), name.begin() + start, name.begin() + end);
+    }
+    start = end + 1;
+  }
+  out.push_back(0);
+}
+
+static void append_rdata(std::vector<uint8_t> &out, const rdata_value_t &rdata) {
+  std::visit(
+      [&out](const auto &v) {
+        typedef std::decay_t<decltype(v)> T;
+        if constexpr (std::is_same_v<T, a_rdata_t> ||
+                      std::is_same_v<T, aaaa_rdata_t>) {
+          out.insert(out.end(), v.ADDRESS.begin(), v.ADDRESS.end());
+        } else if constexpr (std::is_same_v<T, domain_rdata_t>) {
+          append_wire_name(out, v.DOMAIN);
+        } else if constexpr (std::is_same_v<T, mx_rdata_t>) {
+          append16(out, v.PREFERENCE);
+          append_wire_name(out, v.EXCHANGE);
+        } else if constexpr (std::is_same_v<T, txt_rdata_t>) {
+          out.insert(out.end(), v.TXT.begin(), v.TXT.end());
+        } else if constexpr (std::is_same_v<T, soa_rdata_t>) {
+          append_wire_name(out, v.MNAME);
+          append_wire_name(out, v.RNAME);
+          append32(out, v.SERIAL);
+          append32(out, v.REFRESH);
+          append32(out, v.RETRY);
+          append32(out, v.EXPIRE);
+          append32(out, v.MINIMUM);
+        } else if constexpr (std::is_same_v<T, srv_rdata_t>) {
+          append16(out, v.PRIORITY);
+          append16(out, v.WEIGHT);
+          append16(out, v.PORT);
+          append_wire_name(out, v.TARGET);
+        } else {
+          out.insert(out.end(), v.data(), v.data() + v.size());
+        }
+      },
+      rdata);
+}
+
+void append_wire_record(std::vector<uint8_t> &out,
+                        const resource_record_value_t &record) {
+  append_wire_name(out, record.NAME);
+  append16(out, record.TYPE);
+  append16(out, record.CLASS);
+  append32(out, record.TTL);
+
+  size_t lengthOffset = out.size();
+  append16(out, 0);
+  append_rdata(out, record.RDATA);
+  size_t RDLENGTH = out.size() - lengthOffset - 2;
+  out[lengthOffset] = RDLENGTH >> 8;
+  out[lengthOffset + 1] = RDLENGTH & 0xff;
+}
+
+ZoneTransferParser::ZoneTransferParser(Handler handler)
+    : m_handler(handler), m_state(START), m_incremental(false), m_serial(0),
+      m_messages(0), m_records(0) {
+  // biggest frame, allocated once
+  m_pending.reserve(2 + 0xffff);
+}
+
+void ZoneTransferParser::Feed(const uint8_t *data, size_t size) {
+  while (size) {
+    // whole frame in chunk: parse in place
+    if (m_pending.empty() && size >= 2) {
+      size_t length = (data[0] << 8) | data[1];
+      if (size >= 2 + length) {
+        OnMessage(data + 2, length);
+        data += 2 + length;
+        size -= 2 + length;
+        continue;
+      }
+    }
+
+    size_t want = 2;
+    if (m_pending.size() >= 2)
+      want += (m_pending[0] << 8) | m_pending[1];
+    size_t take = std::min(want - m_pending.size(), size);
+    m_pending.insert(m_pending.end(), data, data + take);
+    data += take;
+    size -= take;
+
+    if (m_pending.size() < 2)
+      continue;
+    size_t length = (m_pending[0] << 8) | m_pending[1];
+    if (m_pending.size() == 2 + length) {
+      OnMessage(m_pending.data() + 2, length);
+      m_pending.clear();
+    }
+  }
+}
+
+void ZoneTransferParser::OnMessage(const uint8_t *message, size_t size) {
+  m_parser.Reset(message, size);
+  header_t header = m_parser.GetHeader();
+  if (header.RCODE != 0)
+    throw std::invalid_argument("zone transfer failed, RCODE " +
+                                std::to_string(header.RCODE));
+
+  for (int i = 0; i < header.QDCOUNT; i++)
+    m_parser.GetQuestion(m_question);
+  for (int i = 0; i < header.ANCOUNT; i++) {
+    m_parser.GetResourceRecordValue(m_record);
+    OnRecord(m_record);
+  }
+  // authority and additional (TSIG) sections are not a part of zone
+  m_messages++;
+}
+
+void ZoneTransferParser::Emit(const resource_record_value_t &record,
+                              bool deleted) {
+  m_records++;
+  m_handler(record, deleted);
+}
+
+void ZoneTransferParser::OnRecord(const resource_record_value_t &record) {
+  const soa_rdata_t *soa = nullptr;
+  if (record.TYPE == TYPE_SOA)
+    soa = std::get_if<soa_rdata_t>(&record.RDATA);
+
+  switch (m_state) {
+  case START:
+    if (!soa)
+      throw std::invalid_argument("zone transfer doesn't start with SOA");
+    m_serial = soa->SERIAL;
+    m_firstSoa = record;
+    m_state = FIRST_SOA;
+    break;
+  case FIRST_SOA:
+    // rfc-1995: old SOA after the first one means incremental transfer
+    if (soa && soa->SERIAL != m_serial) {
+      m_incremental = true;
+      m_state = IXFR_DELETE;
+      Emit(record, true);
+      break;
+    }
+    Emit(m_firstSoa, false);
+    m_state = AXFR;
+    if (soa)
+      m_state = COMPLETE; // empty zone
+    else
+      Emit(record, false);
+    break;
+  case AXFR:
+    if (soa)
+      m_state = COMPLETE;
+    else
+      Emit(record, false);
+    break;
+  case IXFR_DELETE:
+    // new SOA starts additions of the sequence
+    if (soa)
+      m_state = IXFR_ADD;
+    Emit(record, !soa);
+    break;
+  case IXFR_ADD:
+    if (soa && soa->SERIAL == m_serial) {
+      m_state = COMPLETE;
+    } else if (soa) {
+      m_state = IXFR_DELETE;
+      Emit(record, true);
+    } else {
+      Emit(record, false);
+    }
+    break;
+  case COMPLETE:
+    throw std::invalid_argument("records after end of zone transfer");
+  }
+}
+
+// rfc-3597: \# length hex, for types without own presentation format
+static void write_unknown_rdata(std::ostream &os, const uint8_t *data,
+                                size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  os << "\\# " << size;
+  if (size)
+    os << ' ';
+  for (size_t i = 0; i < size; i++)
+    os << digits[data[i] >> 4] << digits[data[i] & 0xf];
+}
+
+// rfc-1035 5.1: every <character-string> quoted, '"' and '\' escaped,
+// non-printable bytes as \DDD. Malformed TXT goes as unknown RDATA
+static void write_txt_rdata(std::ostream &os, const std::string &txt) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(txt.data());
+  size_t offset = 0;
+  while (offset < txt.size())
+    offset += 1 + data[offset];
+  if (txt.empty() || offset != txt.size())
+    return write_unknown_rdata(os, data, txt.size());
+
+  for (offset = 0; offset < txt.size(); offset += 1 + data[offset]) {
+    if (offset)
+      os << ' ';
+    os << '"';
+    for (size_t i = offset + 1; i <= offset + data[offset]; i++) {
+      uint8_t c = data[i];
+      if (c == '"' || c == '\\')
+        os << '\\' << c;
+      else if (c < 0x20 || c > 0x7e)
+        os << '\\' << c / 100 << c / 10 % 10 << c % 10;
+      else
+        os << c;
+    }
+    os << '"';
+  }
+}
+
+// rfc-1035 5.1: "." for root, characters special in master files escaped
+// as \c, non-printable bytes as \DDD. Labels are split on dots, a dot inside
+// a label isn't distinguishable in a dotted name
+static void write_zone_name(std::ostream &os, const std::string &name) {
+  bool root = true;
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('.', start);
+    if (end == std::string::npos)
+      end = name.size();
+    for (size_t i = start; i < end; i++) {
+      uint8_t c = name[i];
+      if (c == '"' || c == '(' || c == ')' || c == ';' || c == '\\' ||
+          c == '@' || c == '$' || c == ' ')
+        os << '\\' << c;
+      else if (c < 0x20 || c > 0x7e)
+        os << '\\' << c / 100 << c / 10 % 10 << c % 10;
+      else
+        os << c;
+    }
+    if (end != start) {
+      os << '.';
+      root = false;
+    }
+    start = end + 1;
+  }
+  if (root)
+    os << '.';
+}
+
+void write_zone_text(std::ostream &os, const resource_record_value_t &record,
+                     bool deleted) {
+  if (deleted)
+    os << "; delete ";
+  write_zone_name(os, record.NAME);
+  os << "\t\t" << record.TTL << '\t';
+  // rfc-3597: CLASS<n> and TYPE<n> for ones without mnemonic
+  auto cl = classes.find(record.CLASS);
+  if (cl != classes.end() && record.CLASS != 255)
+    os << cl->second;
+  else
+    os << "CLASS" << record.CLASS;
+  os << '\t';
+  auto type = types.find(record.TYPE);
+  if (type != types.end())
+    os << type->second;
+  else
+    os << "TYPE" << record.TYPE;
+  os << '\t';
+
+  std::visit(
+      [&os](const auto &v) {
+        typedef std::decay_t<decltype(v)> T;
+        if constexpr (std::is_same_v<T, domain_rdata_t>) {
+          write_zone_name(os, v.DOMAIN);
+        } else if constexpr (std::is_same_v<T, mx_rdata_t>) {
+          os << v.PREFERENCE << ' ';
+          write_zone_name(os, v.EXCHANGE);
+        } else if constexpr (std::is_same_v<T, soa_rdata_t>) {
+          write_zone_name(os, v.MNAME);
+          os << ' ';
+          write_zone_name(os, v.RNAME);
+          os << ' ' << v.SERIAL << ' ' << v.REFRESH << ' ' << v.RETRY << ' '
+             << v.EXPIRE << ' ' << v.MINIMUM;
+        } else if constexpr (std::is_same_v<T, srv_rdata_t>) {
+          os << v.PRIORITY << ' ' << v.WEIGHT << ' ' << v.PORT << ' ';
+          write_zone_name(os, v.TARGET);
+        } else if constexpr (std::is_same_v<T, txt_rdata_t>) {
+          write_txt_rdata(os, v.TXT);
+        } else if constexpr (std::is_same_v<T, generic_rdata_t>) {
+          write_unknown_rdata(os, v.data(), v.size());
+        } else {
+          os << (std::string)v;
+        }
+      },
+      record.RDATA);
+  os << '\n';
+}
+
+void write_zone_binary(std::ostream &os, const resource_record_value_t &record,
+                       bool deleted) {
+  static thread_local std::vector<uint8_t> buffer;
+  buffer.clear();
+  buffer.push_back(deleted ? 1 : 0);
+  append16(buffer, 0);
+  append_wire_record(buffer, record);
+  size_t length = buffer.size() - 3;
+  buffer[1] = length >> 8;
+  buffer[2] = length & 0xff;
+  os.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+}
@@ -58,7 +58,9 @@ std::ostream &operator<<(std::ostream &os, const std::unique_ptr<RData> &d) {
   return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const resource_record_t &r) {
+// resource_record_t and resource_record_value_t differs only in RDATA storage
+template <typename RR>
+static std::ostream &print_resource_record(std::ostream &os, const RR &r) {
   /*
   ;; ANSWER SECTION:
   example.com.        76391    IN    A    93.184.216.34
@@ -82,7 +84,8 @@ std::ostream &operator<<(std::ostream &os, const resource_record_t &r) {
   return os;
 }
 
-std::ostream &operator<<(std::ostream &os, const dns_message_t &d) {
+template <typename Message>
+static std::ostream &print_message(std::ostream &os, const Message &d) {
   os << d.Header << std::endl << std::endl;
   if (d.Question.size()) {
     os << ";; QUESTION SECTION:";
@@ -90,22 +93,43 @@ std::ostream &operator<<(std::ostream &os, const dns_message_t &d) {
       os << std::endl << it;
   }
   if (d.Answer.size()) {
-    std::cout << std::endl;
-    std::cout << std::endl << ";; ANSWER SECTION:";
+    os << std::endl;
+    os << std::endl << ";; ANSWER SECTION:";
     for (const auto &it : d.Answer)
       os << std::endl << it;
   }
   if (d.Authority.size()) {
-    std::cout << std::endl;
-    std::cout << std::endl << ";; AUTHORATIVE NAMESERVERS SECTION:";
+    os << std::endl;
+    os << std::endl << ";; AUTHORATIVE NAMESERVERS SECTION:";
     for (const auto &it : d.Authority)
       os << std::endl << it;
   }
   if (d.Additional.size()) {
-    std::cout << std::endl;
-    std::cout << std::endl << ";; ADDITIONAL RECORDS SECTION:";
+    os << std::endl;
+    os << std::endl << ";; ADDITIONAL RECORDS SECTION:";
     for (const auto &it : d.Additional)
       os << std::endl << it;
   }
   return os;
 }
+
+std::ostream &operator<<(std::ostream &os, const rdata_value_t &d) {
+  os << to_string(d);
+  return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const resource_record_t &r) {
+  return print_resource_record(os, r);
+}
+
+std::ostream &operator<<(std::ostream &os, const resource_record_value_t &r) {
+  return print_resource_record(os, r);
+}
+
+std::ostream &operator<<(std::ostream &os, const dns_message_t &d) {
+  return print_message(os, d);
+}
+
+std::ostream &operator<<(std::ostream &os, const dns_message_value_t &d) {
+  return print_message(os, d);
+}
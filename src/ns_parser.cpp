@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
+#include "MessageCache.h"
 #include "MessageParser.h"
+#include "QueryMatcher.h"
+#include "UdpListener.h"
+#include "ZoneTransfer.h"
 #include "RData.h"
 #include "RDataFactory.h"
 #include "dns_constants.h"
@@ -11,7 +21,231 @@
 #include "formatters.h"
 #include "input.h"
 
-int main() {
+// dnsrrparser -bc [file]: same as -b, but repeated messages are taken from
+// cache of parsed and formatted ones
+static int parse_binary_archive_cached(const MappedInput &input) {
+  size_t index = 0;
+  MessageCache cache(65536);
+  for_each_framed_message(
+      input.data(), input.size(), [&](const uint8_t *message, size_t size) {
+        const char *error;
+        if (const cached_message_t *cached = cache.Get(message, size, &error))
+          std::cout << cached->Text << "\n\n";
+        else
+          std::cout << "could not parse message " << index << ": " << error
+                    << "\n\n"
+                    << std::flush;
+        index++;
+      });
+  std::cout << std::flush;
+
+  const message_cache_stats_t &stats = cache.GetStats();
+  std::cerr << ";; cache hits: " << stats.Hits << ", misses: " << stats.Misses
+            << ", hit rate: " << stats.GetHitRate() * 100 << "%" << std::endl;
+  return stats.Malformed ? 1 : 0;
+}
+
+// dnsrrparser -b [file]: archive of length-prefixed messages, stdin if no file
+static int parse_binary_archive(const MappedInput &input) {
+  size_t index = 0;
+  size_t failed = 0;
+  MessageParser mp;
+  dns_message_value_t dm;
+  for_each_framed_message(
+      input.data(), input.size(), [&](const uint8_t *message, size_t size) {
+        mp.Reset(message, size);
+        const char *error;
+        if (mp.TryGetDnsMessageValue(dm, &error)) {
+          std::cout << dm << "\n\n";
+        } else {
+          // one broken message shouldn't stop whole archive
+          std::cout << "could not parse message " << index << ": " << error
+                    << "\n\n"
+                    << std::flush;
+          failed++;
+        }
+        index++;
+      });
+  std::cout << std::flush;
+  return failed ? 1 : 0;
+}
+
+// dnsrrparser -l port [workers]: listen on 0.0.0.0:port, print every message
+static int listen_udp(uint16_t port, size_t workers) {
+  std::mutex outputMutex;
+  UdpListener listener("0.0.0.0", port,
+                       [&](const dns_message_value_t &dm,
+                           const datagram_info_t &) {
+                         std::lock_guard<std::mutex> lock(outputMutex);
+                         std::cout << dm << std::endl << std::endl;
+                       },
+                       workers);
+  listener.Run();
+  return 0;
+}
+
+static uint64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+static void print_matches(const matcher_stats_t &stats,
+                          std::vector<uint64_t> &latencies, size_t outstanding) {
+  std::cout << ";; queries: " << stats.Queries
+            << ", responses: " << stats.Responses
+            << ", matched: " << stats.Matched
+            << ", timed out: " << stats.TimedOut
+            << ", unmatched responses: " << stats.UnmatchedResponses
+            << ", outstanding: " << outstanding;
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << ", latency us p50: " << latencies[latencies.size() / 2]
+              << " p99: " << latencies[latencies.size() * 99 / 100]
+              << " max: " << latencies.back();
+  }
+  std::cout << std::endl;
+  latencies.clear();
+}
+
+// dnsrrparser -m port [seconds]: listen on 0.0.0.0:port for mirrored queries
+// and responses, pair them and print stats every second (latency of the
+// last second). A peer mirrors both directions, so both come from its
+// address: a response is passed to matcher as going back to the peer
+static int match_udp(uint16_t port, size_t seconds) {
+  const uint64_t timeout = 2000000;
+  std::mutex matcherMutex;
+  std::vector<uint64_t> latencies;
+  latencies.reserve(1 << 16);
+  QueryMatcher matcher(timeout, 1 << 16, [&](const match_t &match) {
+    if (!match.TimedOut)
+      latencies.push_back(match.Latency);
+  });
+
+  UdpListener listener(
+      "0.0.0.0", port,
+      [&](const dns_message_value_t &dm, const datagram_info_t &info) {
+        flow_t flow = info.Flow;
+        if (dm.Header.QR) {
+          std::swap(flow.SrcAddress, flow.DstAddress);
+          std::swap(flow.SrcPort, flow.DstPort);
+        }
+        std::lock_guard<std::mutex> lock(matcherMutex);
+        matcher.OnMessage(dm, flow, info.Time);
+      });
+  // matcher needs QNAME hash only, workers get it while decoding
+  listener.SetFoldQName(true, true);
+  std::thread runner(&UdpListener::Run, &listener);
+
+  for (size_t second = 0; !seconds || second < seconds; second++) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::lock_guard<std::mutex> lock(matcherMutex);
+    matcher.Advance(now_us());
+    print_matches(matcher.GetStats(), latencies, matcher.GetOutstanding());
+  }
+  listener.Stop();
+  runner.join();
+
+  matcher.Flush();
+  print_matches(matcher.GetStats(), latencies, matcher.GetOutstanding());
+  return 0;
+}
+
+// dnsrrparser -z[b] [file]: AXFR/IXFR TCP stream, stdin if no file. stream is
+// read by chunks, zone is printed record by record (-zb: binary records)
+static int parse_zone_transfer(const char *path, bool binary) {
+  int fd = path ? open(path, O_RDONLY) : STDIN_FILENO;
+  if (fd < 0) {
+    std::cout << "could not open " << path << std::endl;
+    return 1;
+  }
+
+  ZoneTransferParser parser(
+      [binary](const resource_record_value_t &record, bool deleted) {
+        if (binary)
+          write_zone_binary(std::cout, record, deleted);
+        else
+          write_zone_text(std::cout, record, deleted);
+      });
+
+  std::vector<uint8_t> chunk(1 << 16);
+  ssize_t got;
+  while ((got = read(fd, chunk.data(), chunk.size())) > 0)
+    parser.Feed(chunk.data(), got);
+  if (path)
+    close(fd);
+
+  if (!parser.IsComplete()) {
+    std::cerr << "zone transfer is not complete" << std::endl;
+    return 1;
+  }
+  std::cerr << ";; " << (parser.IsIncremental() ? "IXFR" : "AXFR")
+            << " serial " << parser.GetSerial() << ": "
+            << parser.GetRecordCount() << " records in "
+            << parser.GetMessageCount() << " messages" << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && (std::strcmp(argv[1], "-z") == 0 ||
+                   std::strcmp(argv[1], "-zb") == 0)) {
+    try {
+      return parse_zone_transfer(argc > 2 ? argv[2] : nullptr,
+                                 argv[1][2] == 'b');
+    } catch (std::invalid_argument &e) {
+      std::cout << "could not parse zone transfer: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (argc > 2 && std::strcmp(argv[1], "-l") == 0) {
+    try {
+      size_t workers = (argc > 3) ? std::stoul(argv[3]) : 1;
+      unsigned long port = std::stoul(argv[2]);
+      if (port > 0xffff)
+        throw std::out_of_range("port should be less than 65536");
+      return listen_udp(port, workers);
+    } catch (std::exception &e) {
+      std::cout << "could not listen: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (argc > 2 && std::strcmp(argv[1], "-m") == 0) {
+    try {
+      size_t seconds = (argc > 3) ? std::stoul(argv[3]) : 0;
+      unsigned long port = std::stoul(argv[2]);
+      if (port > 0xffff)
+        throw std::out_of_range("port should be less than 65536");
+      return match_udp(port, seconds);
+    } catch (std::exception &e) {
+      std::cout << "could not listen: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (argc > 1 && std::strcmp(argv[1], "-bc") == 0) {
+    try {
+      if (argc > 2)
+        return parse_binary_archive_cached(MappedInput(argv[2]));
+      return parse_binary_archive_cached(MappedInput(STDIN_FILENO));
+    } catch (std::exception &e) {
+      std::cout << "could not read archive: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  if (argc > 1 && std::strcmp(argv[1], "-b") == 0) {
+    try {
+      if (argc > 2)
+        return parse_binary_archive(MappedInput(argv[2]));
+      return parse_binary_archive(MappedInput(STDIN_FILENO));
+    } catch (std::exception &e) {
+      std::cout << "could not read archive: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
   /* Enter your code here. Read input from STDIN. Print output to STDOUT */
   try {
     std::vector<uint8_t> raw_data = get_raw_data(std::cin);
@@ -0,0 +1,35 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+// counter of the innermost AllocationCounter of this thread, if any
+static thread_local size_t *current = nullptr;
+
+void *operator new(size_t size)
+{
+	if (current)
+		(*current)++;
+	if (void *ret = std::malloc(size ? size : 1))
+		return ret;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+AllocationCounter::AllocationCounter() : m_count(0), m_previous(current)
+{
+	current = &m_count;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+	current = m_previous;
+}
@@ -0,0 +1,23 @@
+#ifndef ALLOCATION_COUNTER
+#define ALLOCATION_COUNTER
+
+#include <cstddef>
+
+// counts operator new calls of the current thread while it's alive, the rest
+// of test binary isn't affected. Replacement of operator new is in
+// AllocationCounter.cpp
+class AllocationCounter
+{
+public:
+	AllocationCounter();
+	~AllocationCounter();
+	AllocationCounter(const AllocationCounter &) = delete;
+
+	size_t Count() const { return m_count; }
+
+private:
+	size_t m_count;
+	size_t *m_previous;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "MessageParser.h"
+#include "dnsrrparser.h"
+#include "TestInputs.h"
+
+
+static std::string decode_name(const std::vector<uint8_t> &message, uint32_t offset)
+{
+	char name[256];
+	int length = dnsrr_decode_name(message.data(), message.size(), offset, name, sizeof(name));
+	EXPECT_GE(length, 0);
+	return length < 0 ? "" : std::string(name, length);
+}
+
+
+class CApiTest :  public testing::TestWithParam<const char*> {
+
+};
+
+static std::vector<const char*> capi_files()
+{
+	std::vector<const char*> ret(std::begin(wellFormedInputs), std::end(wellFormedInputs));
+	for (const auto &it : adversarialInputs)
+		ret.push_back(it.first);
+	return ret;
+}
+
+
+INSTANTIATE_TEST_SUITE_P(Input,CApiTest,
+		testing::ValuesIn(
+				capi_files()
+			));
+
+
+TEST_P(CApiTest, MatchesParser)
+{
+	std::vector<uint8_t> message = read_input(GetParam());
+	MessageParser mp(message.data(), message.size());
+	dns_message_value_t dm;
+	bool valid = mp.TryGetDnsMessageValue(dm);
+
+	dnsrr_buffer_t buffer = {message.data(), message.size()};
+	dnsrr_message_t result;
+	std::vector<dnsrr_entry_t> entries(0x10000);
+	size_t used = 0;
+	ASSERT_EQ(dnsrr_parse_batch(&buffer, 1, &result, entries.data(), entries.size(), &used), 1u);
+	ASSERT_EQ(result.status, valid ? DNSRR_OK : DNSRR_MALFORMED);
+	if (!valid)
+	{
+		EXPECT_NE(result.error, nullptr);
+		EXPECT_EQ(used, 0u);
+		return;
+	}
+	EXPECT_EQ(result.error, nullptr);
+	EXPECT_EQ(result.header.id, dm.Header.ID);
+	EXPECT_EQ(result.header.rcode, dm.Header.RCODE);
+	EXPECT_EQ(result.header.qr, dm.Header.QR);
+	EXPECT_EQ(result.header.ancount, dm.Header.ANCOUNT);
+
+	ASSERT_EQ(used, dm.Question.size() + dm.Answer.size() + dm.Authority.size() + dm.Additional.size());
+	ASSERT_EQ(result.entry_count, used);
+	size_t i = result.first_entry;
+	for (const question_t &q : dm.Question)
+	{
+		EXPECT_EQ(entries[i].section, DNSRR_QUESTION);
+		EXPECT_EQ(decode_name(message, entries[i].name_offset), q.QNAME);
+		EXPECT_EQ(entries[i].type, q.QTYPE);
+		EXPECT_EQ(entries[i].rclass, q.QCLASS);
+		i++;
+	}
+	const std::vector<resource_record_value_t> *sections[] = {&dm.Answer, &dm.Authority, &dm.Additional};
+	for (uint16_t section = DNSRR_ANSWER; section <= DNSRR_ADDITIONAL; section++)
+		for (const resource_record_value_t &rr : *sections[section - 1])
+		{
+			const dnsrr_entry_t &entry = entries[i++];
+			EXPECT_EQ(entry.section, section);
+			EXPECT_EQ(decode_name(message, entry.name_offset), rr.NAME);
+			EXPECT_EQ(entry.type, rr.TYPE);
+			EXPECT_EQ(entry.ttl, rr.TTL);
+			// RDATA in place is the same as parser sees it, RDLENGTH precedes it
+			MessageParser rdata(message.data(), message.size());
+			rdata.Seek(entry.rdata_offset - sizeof(uint16_t));
+			EXPECT_EQ(to_string(rdata.GetRDataValue(entry.type)), to_string(rr.RDATA));
+			EXPECT_EQ(rdata.GetCurrentOffset(), entry.rdata_offset + entry.rdata_length);
+		}
+}
+
+TEST(CApi, BatchStopsWhenEntriesDontFit)
+{
+	std::vector<std::vector<uint8_t>> messages = {read_input("inputQAuthAdd"), {1, 2, 3},
+		read_input("inputQAAAA"), read_input("inputQSRV")};
+	std::vector<dnsrr_buffer_t> buffers;
+	for (const auto &m : messages)
+		buffers.push_back({m.data(), m.size()});
+
+	std::vector<dnsrr_message_t> all(buffers.size());
+	std::vector<dnsrr_entry_t> entries(1024);
+	size_t total = 0;
+	ASSERT_EQ(dnsrr_parse_batch(buffers.data(), buffers.size(), all.data(), entries.data(), entries.size(), &total), buffers.size());
+	EXPECT_EQ(all[1].status, DNSRR_MALFORMED);
+	ASSERT_GT(total, all[0].entry_count);
+
+	// room for the first message, the third one doesn't fit after it, but
+	// would fit alone: the rest is left for the next call
+	size_t used = 0;
+	std::vector<dnsrr_message_t> part(buffers.size());
+	part[2].status = -1;
+	size_t capacity = all[0].entry_count + all[2].entry_count - 1;
+	size_t parsed = dnsrr_parse_batch(buffers.data(), buffers.size(), part.data(), entries.data(), capacity, &used);
+	EXPECT_EQ(parsed, 2u);
+	EXPECT_EQ(used, all[0].entry_count);
+	EXPECT_EQ(part[1].status, DNSRR_MALFORMED);
+	// message which didn't fit isn't reported as parsed
+	EXPECT_EQ(part[2].status, -1);
+	EXPECT_EQ(part[2].entry_count, 0u);
+
+	parsed += dnsrr_parse_batch(buffers.data() + parsed, buffers.size() - parsed, part.data() + parsed,
+		entries.data() + used, entries.size() - used, &used);
+	EXPECT_EQ(parsed, buffers.size());
+	EXPECT_EQ(used, total - all[0].entry_count);
+
+	EXPECT_EQ(dnsrr_abi_version(), (uint32_t)DNSRR_ABI_VERSION);
+}
+
+TEST(CApi, BatchSkipsMessageLargerThanCapacity)
+{
+	std::vector<std::vector<uint8_t>> messages = {read_input("inputQAAAd"), read_input("input")};
+	std::vector<dnsrr_buffer_t> buffers;
+	for (const auto &m : messages)
+		buffers.push_back({m.data(), m.size()});
+	dnsrr_message_t whole;
+	std::vector<dnsrr_entry_t> entries(1024);
+	size_t needed = 0;
+	ASSERT_EQ(dnsrr_parse_batch(buffers.data(), 1, &whole, entries.data(), entries.size(), &needed), 1u);
+	ASSERT_GT(needed, 2u);
+
+	// no call with 2 entries would fit the first one, it's consumed anyway
+	dnsrr_entry_t small[2];
+	dnsrr_message_t part[2];
+	size_t used = 0;
+	ASSERT_EQ(dnsrr_parse_batch(buffers.data(), buffers.size(), part, small, 2, &used), 2u);
+	EXPECT_EQ(part[0].status, DNSRR_TOO_MANY_ENTRIES);
+	EXPECT_NE(part[0].error, nullptr);
+	EXPECT_EQ(part[0].header.id, whole.header.id);
+	EXPECT_EQ(part[0].entry_count, needed);
+	EXPECT_EQ(part[0].first_entry, 0u);
+	EXPECT_EQ(part[1].status, DNSRR_OK);
+	EXPECT_EQ(part[1].first_entry, 0u);
+	EXPECT_EQ(used, part[1].entry_count);
+
+	EXPECT_EQ(dnsrr_parse_batch(buffers.data(), 1, part, entries.data(), 0, &used), 1u);
+	EXPECT_EQ(part[0].status, DNSRR_TOO_MANY_ENTRIES);
+	EXPECT_EQ(used, 0u);
+}
+
+TEST(CApi, DecodeNameRejectsBadInput)
+{
+	std::vector<uint8_t> message = read_input("inputQAA");
+	char name[4];
+	EXPECT_EQ(dnsrr_decode_name(message.data(), message.size(), 12, name, sizeof(name)), -1);
+	EXPECT_EQ(dnsrr_decode_name(message.data(), message.size(), message.size(), name, sizeof(name)), -1);
+
+	std::vector<uint8_t> loop = read_input("adversarial/pointerLoop");
+	char buffer[256];
+	EXPECT_EQ(dnsrr_decode_name(loop.data(), loop.size(), 12, buffer, sizeof(buffer)), -1);
+}
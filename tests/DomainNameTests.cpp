@@ -0,0 +1,166 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "MessageParser.h"
+#include "TestInputs.h"
+
+
+static std::vector<uint8_t> wire_name(const std::vector<std::string> &labels)
+{
+	std::vector<uint8_t> ret;
+	for (const std::string &label : labels)
+	{
+		ret.push_back(label.size());
+		ret.insert(ret.end(), label.begin(), label.end());
+	}
+	ret.push_back(0);
+	return ret;
+}
+
+static std::string lowercase(std::string name)
+{
+	for (char &c : name)
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+	return name;
+}
+
+static bool is_hostname(const std::vector<uint8_t> &wire)
+{
+	for (size_t i = 0; wire[i]; i += wire[i] + 1)
+		for (char c : lowercase(std::string(wire.begin() + i + 1, wire.begin() + i + 1 + wire[i])))
+			if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_'))
+				return false;
+	return true;
+}
+
+// name is the whole buffer: reading past it is caught by address sanitizer
+static void expect_folded(const std::vector<uint8_t> &wire)
+{
+	std::vector<uint8_t> exact(wire);
+	MessageParser plain(exact.data(), exact.size());
+	std::string expected = plain.GetDomainName();
+
+	MessageParser mp(exact.data(), exact.size());
+	std::string name;
+	folded_name_t folded;
+	mp.GetDomainName(name, folded);
+	EXPECT_EQ(name, expected);
+	EXPECT_EQ(mp.GetCurrentOffset(), exact.size());
+	EXPECT_EQ(folded.Lowercase, lowercase(expected));
+	EXPECT_EQ(folded.Hash, hash_domain_name(expected));
+	EXPECT_EQ(folded.Hash, hash_domain_name(folded.Lowercase));
+	EXPECT_EQ(folded.Hostname, is_hostname(wire));
+}
+
+
+TEST(DomainName, FoldsCase)
+{
+	std::vector<uint8_t> upper = wire_name({"WwW", "ExAmPle-1", "COM"});
+	MessageParser mp(upper.data(), upper.size());
+	std::string name;
+	folded_name_t folded;
+	mp.GetDomainName(name, folded);
+	EXPECT_EQ(name, "WwW.ExAmPle-1.COM.");
+	EXPECT_EQ(folded.Lowercase, "www.example-1.com.");
+	EXPECT_EQ(folded.Hash, hash_domain_name("www.example-1.com."));
+	EXPECT_NE(folded.Hash, hash_domain_name("www.example-2.com."));
+	EXPECT_TRUE(folded.Hostname);
+
+	expect_folded(upper);
+	expect_folded(wire_name({}));
+	expect_folded(wire_name({"_sip", "_tcp", "Example", "org"}));
+	expect_folded(wire_name({"with space", "org"}));
+	expect_folded(wire_name({"dot.inside", "org"}));
+	// letters next to the ASCII range of upper case
+	expect_folded(wire_name({"@[`{", "Z", "a"}));
+}
+
+TEST(DomainName, LabelsOfEveryLength)
+{
+	std::mt19937 random(20);
+	for (size_t length = 1; length <= 63; length++)
+		for (int i = 0; i < 20; i++)
+		{
+			std::string label(length, 'a');
+			for (char &c : label)
+			{
+				const char alphabet[] = "aZ09-_.";
+				c = alphabet[random() % (sizeof(alphabet) - 1)];
+			}
+			// sometimes any byte at any position: high bytes too
+			if (i % 2)
+				label[random() % length] = random() % 256;
+			expect_folded(wire_name({label}));
+			expect_folded(wire_name({label, label, "Com"}));
+		}
+}
+
+TEST(DomainName, CompressedNames)
+{
+	for (const char *file : wellFormedInputs)
+	{
+		std::vector<uint8_t> message = read_input(file);
+		MessageParser mp(message.data(), message.size());
+		dns_message_value_t dm = mp.GetDnsMessageValue();
+
+		// QNAME and owner of the first answer, the latter is compressed usually
+		MessageParser folding(message.data(), message.size());
+		folding.GetHeader();
+		std::string name;
+		folded_name_t folded;
+		folding.GetDomainName(name, folded);
+		EXPECT_EQ(name, dm.Question[0].QNAME);
+		EXPECT_EQ(folded.Hash, hash_domain_name(name));
+		folding.Get<uint32_t>();
+		if (!dm.Answer.empty())
+		{
+			folding.GetDomainName(name, folded);
+			EXPECT_EQ(name, dm.Answer[0].NAME);
+			EXPECT_EQ(folded.Lowercase, lowercase(name));
+			EXPECT_EQ(folded.Hash, hash_domain_name(name));
+		}
+	}
+}
+
+TEST(DomainName, FoldedQName)
+{
+	MessageParser mp;
+	mp.SetFoldQName(true);
+	dns_message_value_t dm;
+	for (const char *file : wellFormedInputs)
+	{
+		std::vector<uint8_t> message = read_input(file);
+		mp.Reset(message.data(), message.size());
+		ASSERT_TRUE(mp.TryGetDnsMessageValue(dm));
+		ASSERT_TRUE(dm.HasFoldedQNAME);
+		EXPECT_FALSE(dm.FoldedQNAME.HashOnly);
+		EXPECT_EQ(dm.FoldedQNAME.Lowercase, lowercase(dm.Question[0].QNAME));
+		EXPECT_EQ(dm.FoldedQNAME.Hash, hash_domain_name(dm.Question[0].QNAME));
+	}
+
+	// the same hash, lowercase copy isn't made
+	MessageParser hashing;
+	hashing.SetFoldQName(true, true);
+	for (const char *file : wellFormedInputs)
+	{
+		std::vector<uint8_t> message = read_input(file);
+		hashing.Reset(message.data(), message.size());
+		ASSERT_TRUE(hashing.TryGetDnsMessageValue(dm));
+		ASSERT_TRUE(dm.HasFoldedQNAME);
+		EXPECT_TRUE(dm.FoldedQNAME.HashOnly);
+		EXPECT_TRUE(dm.FoldedQNAME.Lowercase.empty());
+		EXPECT_EQ(dm.FoldedQNAME.Hash, hash_domain_name(dm.Question[0].QNAME));
+	}
+
+	// header only: no question to fold
+	std::vector<uint8_t> header(12, 0);
+	mp.Reset(header.data(), header.size());
+	ASSERT_TRUE(mp.TryGetDnsMessageValue(dm));
+	EXPECT_FALSE(dm.HasFoldedQNAME);
+
+	MessageParser plain;
+	std::vector<uint8_t> message = read_input("input");
+	plain.Reset(message.data(), message.size());
+	ASSERT_TRUE(plain.TryGetDnsMessageValue(dm));
+	EXPECT_FALSE(dm.HasFoldedQNAME);
+}
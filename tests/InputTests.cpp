@@ -54,3 +54,36 @@ TEST_P(InvalidInput, SmokeTest)
 	std::stringstream ss(GetParam());
 	EXPECT_THROW( get_raw_data(ss), std::invalid_argument );
 }
+
+
+TEST(FramedInput, WalksFrames)
+{
+	const uint8_t archive[] = { 0x00, 0x02, 0xaa, 0xbb, 0x00, 0x00, 0x00, 0x01, 0xcc };
+	std::vector<size_t> sizes;
+	std::vector<const uint8_t*> messages;
+	for_each_framed_message(archive, sizeof(archive), [&](const uint8_t *message, size_t size) {
+		messages.push_back(message);
+		sizes.push_back(size);
+	});
+	ASSERT_EQ(sizes.size(), 3u);
+	EXPECT_EQ(sizes[0], 2u);
+	EXPECT_EQ(sizes[1], 0u);
+	EXPECT_EQ(sizes[2], 1u);
+	EXPECT_EQ(messages[0], archive + 2);
+	EXPECT_EQ(messages[2], archive + 8);
+}
+
+
+TEST(FramedInput, CutArchive)
+{
+	const uint8_t archive[] = { 0x00, 0x02, 0xaa, 0xbb, 0x00, 0x02, 0xcc };
+	auto skip = [](const uint8_t *, size_t) {};
+	for (size_t i = 1; i < sizeof(archive); i++)
+	{
+		if (i != 4)
+		{
+			EXPECT_THROW(for_each_framed_message(archive, i, skip), std::invalid_argument);
+		}
+	}
+	EXPECT_NO_THROW(for_each_framed_message(archive, 4, skip));
+}
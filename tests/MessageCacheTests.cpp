@@ -0,0 +1,75 @@
+#include <sstream>
+#include "gtest/gtest.h"
+#include "formatters.h"
+#include "MessageCache.h"
+#include "TestInputs.h"
+
+
+static std::string format(const std::vector<uint8_t> &message)
+{
+	MessageParser mp(message.data(), message.size());
+	std::stringstream ss;
+	ss << mp.GetDnsMessageValue();
+	return ss.str();
+}
+
+
+TEST(MessageCache, PatchesId)
+{
+	std::vector<uint8_t> message = read_input("inputQAAAd");
+	MessageCache cache(4);
+
+	for (uint16_t id : {60863, 1, 65535, 60863, 42})
+	{
+		message[0] = id >> 8;
+		message[1] = id & 0xff;
+		const cached_message_t *cached = cache.Get(message.data(), message.size());
+		ASSERT_NE(cached, nullptr);
+		EXPECT_EQ(cached->Message.Header.ID, id);
+		EXPECT_EQ(cached->Text, format(message));
+	}
+	EXPECT_EQ(cache.GetStats().Misses, 1u);
+	EXPECT_EQ(cache.GetStats().Hits, 4u);
+	EXPECT_DOUBLE_EQ(cache.GetStats().GetHitRate(), 0.8);
+}
+
+
+TEST(MessageCache, EvictsLeastRecentlyUsed)
+{
+	std::vector<std::vector<uint8_t>> messages;
+	for (const char *file : {"input", "inputQAA", "inputQAAAA"})
+		messages.push_back(read_input(file));
+	MessageCache cache(2, false);
+
+	cache.Get(messages[0].data(), messages[0].size());
+	cache.Get(messages[1].data(), messages[1].size());
+	cache.Get(messages[0].data(), messages[0].size()); // 1 is the oldest now
+	cache.Get(messages[2].data(), messages[2].size()); // evicts 1
+	EXPECT_EQ(cache.GetStats().Evictions, 1u);
+
+	const cached_message_t *cached = cache.Get(messages[0].data(), messages[0].size());
+	ASSERT_NE(cached, nullptr);
+	EXPECT_TRUE(cached->Text.empty());
+	EXPECT_EQ(cache.GetStats().Hits, 2u);
+
+	cache.Get(messages[1].data(), messages[1].size());
+	EXPECT_EQ(cache.GetStats().Misses, 4u);
+	EXPECT_EQ(cache.GetStats().Evictions, 2u);
+}
+
+
+TEST(MessageCache, Malformed)
+{
+	std::vector<uint8_t> message = read_input("input");
+	MessageCache cache(1);
+	const char *error = nullptr;
+	EXPECT_EQ(cache.Get(message.data(), message.size() - 1, &error), nullptr);
+	EXPECT_STREQ(error, "out of bound");
+	EXPECT_EQ(cache.Get(message.data(), 1, &error), nullptr);
+	EXPECT_STREQ(error, "could not parse dns header");
+	EXPECT_NE(cache.Get(message.data(), message.size(), &error), nullptr);
+	EXPECT_EQ(error, nullptr);
+	EXPECT_NE(cache.Get(message.data(), message.size()), nullptr);
+	EXPECT_EQ(cache.GetStats().Malformed, 2u);
+	EXPECT_EQ(cache.GetStats().Hits, 1u);
+}
@@ -2,23 +2,19 @@
 #include "gtest/gtest.h"
 #include "input.h"
 #include "MessageParser.h"
+#include "TestInputs.h"
 #include <vector>
 #include <iostream>
+#include <unistd.h>
 
 
 class ParsingTest :  public testing::TestWithParam<const char*> {
 
 };
 
-const char* inputFiles[] =
-{
-	"input", "inputQAA", "inputQAAAA", "inputQAAAd", "inputQAuthAdd", "inputQSRV"
-};
-
-
 INSTANTIATE_TEST_SUITE_P(Input,ParsingTest,
 		testing::ValuesIn(
-				inputFiles
+				wellFormedInputs
 			));
 
 
@@ -47,3 +43,133 @@ TEST_P(ParsingTest, SmokeTest)
 }
 
 
+
+TEST_P(ParsingTest, ValueRecordsMatchRData)
+{
+	std::string path = "inputs/";
+	path += GetParam();
+	std::ifstream istrm(path,std::ifstream::in);
+	std::vector<uint8_t> input = get_raw_data(istrm);
+	std::vector<uint8_t> inputCopy(input);
+
+	MessageParser mp(std::move(input));
+	MessageParser mpValue(std::move(inputCopy));
+	dns_message_t dm = mp.GetDnsMessage();
+	dns_message_value_t dmv = mpValue.GetDnsMessageValue();
+
+	ASSERT_EQ(dm.Answer.size(), dmv.Answer.size());
+	ASSERT_EQ(dm.Authority.size(), dmv.Authority.size());
+	ASSERT_EQ(dm.Additional.size(), dmv.Additional.size());
+	for (size_t i = 0; i < dm.Answer.size(); i++)
+		EXPECT_EQ((std::string)*dm.Answer[i].RDATA, to_string(dmv.Answer[i].RDATA));
+	for (size_t i = 0; i < dm.Authority.size(); i++)
+		EXPECT_EQ((std::string)*dm.Authority[i].RDATA, to_string(dmv.Authority[i].RDATA));
+	for (size_t i = 0; i < dm.Additional.size(); i++)
+		EXPECT_EQ((std::string)*dm.Additional[i].RDATA, to_string(dmv.Additional[i].RDATA));
+	EXPECT_EQ(mp.GetCurrentOffset(), mpValue.GetCurrentOffset());
+}
+
+TEST(MappedArchive, ParsesAllInputs)
+{
+	char path[] = "/tmp/dnsrrparser_archiveXXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_GE(fd, 0);
+	close(fd);
+	{
+		std::ofstream archive(path, std::ofstream::binary);
+		for (const char *file : wellFormedInputs)
+		{
+			std::vector<uint8_t> input = read_input(file);
+			archive.put(input.size() >> 8);
+			archive.put(input.size() & 0xff);
+			archive.write(reinterpret_cast<const char*>(input.data()), input.size());
+		}
+	}
+
+	size_t parsed = 0;
+	{
+		MappedInput mapped(path);
+		for_each_framed_message(mapped.data(), mapped.size(), [&](const uint8_t *message, size_t size) {
+			MessageParser mp(message, size);
+			EXPECT_NO_THROW(mp.GetDnsMessageValue());
+			EXPECT_EQ(mp.GetCurrentOffset(), size);
+			parsed++;
+		});
+	}
+	unlink(path);
+	EXPECT_EQ(parsed, sizeof(wellFormedInputs) / sizeof(wellFormedInputs[0]));
+}
+
+
+// CheckDnsMessage and non-throwing pass should agree with real parser on
+// every message
+static void expect_check_agrees(const std::vector<uint8_t> &message)
+{
+	MessageParser checker(message.data(), message.size());
+	const char *error = checker.CheckDnsMessage();
+
+	MessageParser tryParser(message.data(), message.size());
+	dns_message_value_t dm;
+	const char *tryError = nullptr;
+	bool tryParsed = tryParser.TryGetDnsMessageValue(dm, &tryError);
+	EXPECT_EQ(tryParsed, tryError == nullptr);
+
+	MessageParser mp(message.data(), message.size());
+	bool parsed = true;
+	try {
+		mp.GetDnsMessageValue();
+	} catch (std::invalid_argument &e) {
+		parsed = false;
+	}
+	EXPECT_EQ(error == nullptr, parsed) << (error ? error : "");
+	EXPECT_EQ(tryParsed, parsed) << (tryError ? tryError : "");
+}
+
+
+class AdversarialTest :  public testing::TestWithParam<std::pair<const char*, bool>> {
+
+};
+
+INSTANTIATE_TEST_SUITE_P(Input,AdversarialTest,
+		testing::ValuesIn(
+				adversarialInputs
+			));
+
+
+TEST_P(AdversarialTest, BoundedParsing)
+{
+	std::vector<uint8_t> message = read_input(GetParam().first);
+	MessageParser mp(message.data(), message.size());
+	dns_message_value_t dm;
+	EXPECT_EQ(mp.TryGetDnsMessageValue(dm), GetParam().second);
+	expect_check_agrees(message);
+
+	MessageParser mpOld(message.data(), message.size());
+	if (GetParam().second)
+	{
+		EXPECT_NO_THROW(mpOld.GetDnsMessage());
+	}
+	else
+	{
+		EXPECT_THROW(mpOld.GetDnsMessage(), std::invalid_argument);
+	}
+}
+
+
+TEST_P(ParsingTest, CheckAgreesOnMutations)
+{
+	std::vector<uint8_t> input = read_input(GetParam());
+	expect_check_agrees(input);
+
+	// deterministic, so failures are reproducible
+	uint32_t seed = 12345;
+	auto next = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 16; };
+	for (int i = 0; i < 2000; i++)
+	{
+		std::vector<uint8_t> mutated(input);
+		int flips = 1 + next() % 4;
+		for (int j = 0; j < flips; j++)
+			mutated[next() % mutated.size()] = next() & 0xff;
+		expect_check_agrees(mutated);
+	}
+}
@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+#include "QueryMatcher.h"
+#include <vector>
+
+
+static dns_message_value_t make_message(uint16_t id, bool response, const char *qname, uint16_t qtype = 1)
+{
+	dns_message_value_t ret = {};
+	ret.Header.ID = id;
+	ret.Header.QR = response;
+	ret.Header.QDCOUNT = 1;
+	ret.Question.push_back({qname, qtype, 1});
+	return ret;
+}
+
+static flow_t make_flow(uint8_t client, uint16_t clientPort, bool toServer = true)
+{
+	flow_t ret = {};
+	ret.SrcAddress[0] = 10;
+	ret.SrcAddress[3] = client;
+	ret.DstAddress[0] = 8;
+	ret.DstAddress[3] = 8;
+	ret.SrcPort = clientPort;
+	ret.DstPort = 53;
+	if (!toServer)
+	{
+		std::swap(ret.SrcAddress, ret.DstAddress);
+		std::swap(ret.SrcPort, ret.DstPort);
+	}
+	return ret;
+}
+
+
+class QueryMatcherTest : public testing::Test {
+protected:
+	std::vector<match_t> matches;
+	QueryMatcher matcher{1000000, 16, [this](const match_t &m) { matches.push_back(m); }};
+};
+
+
+TEST_F(QueryMatcherTest, MatchesResponse)
+{
+	matcher.OnMessage(make_message(1, false, "example.com."), make_flow(1, 5000), 100);
+	matcher.OnMessage(make_message(1, true, "EXAMPLE.com."), make_flow(1, 5000, false), 2600);
+
+	ASSERT_EQ(matches.size(), 1u);
+	EXPECT_FALSE(matches[0].TimedOut);
+	EXPECT_EQ(matches[0].Latency, 2500u);
+	EXPECT_EQ(matches[0].ID, 1);
+	EXPECT_EQ(matches[0].Flow.SrcPort, 5000);
+	EXPECT_EQ(matcher.GetStats().Matched, 1u);
+	EXPECT_EQ(matcher.GetOutstanding(), 0u);
+}
+
+
+TEST_F(QueryMatcherTest, KeyFieldsMustMatch)
+{
+	matcher.OnMessage(make_message(1, false, "example.com."), make_flow(1, 5000), 0);
+	matcher.OnMessage(make_message(2, true, "example.com."), make_flow(1, 5000, false), 10);
+	matcher.OnMessage(make_message(1, true, "example.org."), make_flow(1, 5000, false), 10);
+	matcher.OnMessage(make_message(1, true, "example.com.", 28), make_flow(1, 5000, false), 10);
+	matcher.OnMessage(make_message(1, true, "example.com."), make_flow(2, 5000, false), 10);
+	matcher.OnMessage(make_message(1, true, "example.com."), make_flow(1, 5001, false), 10);
+
+	EXPECT_TRUE(matches.empty());
+	EXPECT_EQ(matcher.GetStats().UnmatchedResponses, 5u);
+	EXPECT_EQ(matcher.GetOutstanding(), 1u);
+}
+
+
+TEST_F(QueryMatcherTest, TimesOut)
+{
+	matcher.OnMessage(make_message(1, false, "example.com."), make_flow(1, 5000), 0);
+	matcher.OnMessage(make_message(2, false, "example.com."), make_flow(1, 5000), 500000);
+	matcher.Advance(999999);
+	EXPECT_TRUE(matches.empty());
+
+	matcher.Advance(1000000);
+	ASSERT_EQ(matches.size(), 1u);
+	EXPECT_TRUE(matches[0].TimedOut);
+	EXPECT_EQ(matches[0].ID, 1);
+
+	matcher.OnMessage(make_message(1, true, "example.com."), make_flow(1, 5000, false), 1000001);
+	EXPECT_EQ(matcher.GetStats().UnmatchedResponses, 1u);
+
+	// long pause: everything left expires at once
+	matcher.Advance(1000000000);
+	EXPECT_EQ(matches.size(), 2u);
+	EXPECT_EQ(matcher.GetStats().TimedOut, 2u);
+	EXPECT_EQ(matcher.GetOutstanding(), 0u);
+}
+
+
+TEST_F(QueryMatcherTest, BoundedCapacity)
+{
+	for (uint16_t i = 0; i < 20; i++)
+		matcher.OnMessage(make_message(i, false, "example.com."), make_flow(1, 5000), 0);
+	matcher.OnMessage(make_message(0, false, "example.com."), make_flow(1, 5000), 0);
+
+	EXPECT_EQ(matcher.GetOutstanding(), 16u);
+	EXPECT_EQ(matcher.GetStats().Overflows, 4u);
+	EXPECT_EQ(matcher.GetStats().Duplicates, 1u);
+
+	matcher.Flush();
+	EXPECT_EQ(matches.size(), 16u);
+	EXPECT_EQ(matcher.GetOutstanding(), 0u);
+}
+
+
+TEST(QueryMatcher, ManyOutstanding)
+{
+	// responses in different order than queries: stresses deletion from table
+	size_t matched = 0;
+	QueryMatcher matcher(1000000, 4096, [&](const match_t &m) { matched += !m.TimedOut; });
+	for (int round = 0; round < 3; round++)
+	{
+		for (uint16_t i = 0; i < 4096; i++)
+			matcher.OnMessage(make_message(i, false, "example.com."), make_flow(i % 7, 5000 + i % 13), round * 10);
+		for (uint16_t i = 0; i < 4096; i++)
+		{
+			uint16_t id = (i * 2654435761u) % 4096; // permutation of 0..4095
+			matcher.OnMessage(make_message(id, true, "example.com."), make_flow(id % 7, 5000 + id % 13, false), round * 10 + 1);
+		}
+		EXPECT_EQ(matcher.GetOutstanding(), 0u);
+	}
+	EXPECT_EQ(matched, 3 * 4096u);
+	EXPECT_EQ(matcher.GetStats().UnmatchedResponses, 0u);
+}
+
+
+// QNAME folded by parser gives the same key as one hashed by matcher
+TEST_F(QueryMatcherTest, UsesFoldedQName)
+{
+	dns_message_value_t query = make_message(1, false, "Example.COM.");
+	dns_message_value_t response = make_message(1, true, "example.com.");
+	response.HasFoldedQNAME = true;
+	response.FoldedQNAME.Hash = hash_domain_name("example.com.");
+	matcher.OnMessage(query, make_flow(1, 5000), 0);
+	matcher.OnMessage(response, make_flow(1, 5000, false), 10);
+	ASSERT_EQ(matches.size(), 1u);
+
+	// hash is taken as is: QNAME isn't looked at
+	matcher.OnMessage(query, make_flow(1, 5000), 20);
+	response.FoldedQNAME.Hash++;
+	matcher.OnMessage(response, make_flow(1, 5000, false), 30);
+	EXPECT_EQ(matches.size(), 1u);
+	EXPECT_EQ(matcher.GetStats().UnmatchedResponses, 1u);
+}
@@ -0,0 +1,119 @@
+#include <fstream>
+#include "gtest/gtest.h"
+#include "AllocationCounter.h"
+#include "input.h"
+#include "MessageParser.h"
+
+
+class ReuseTest :  public testing::TestWithParam<const char*> {
+
+};
+
+const char* reuseFiles[] =
+{
+	"input", "inputQAA", "inputQAAAA", "inputQAAAd", "inputQAuthAdd", "inputQSRV",
+	"adversarial/manyEmptyRecords"
+};
+
+
+INSTANTIATE_TEST_SUITE_P(Input,ReuseTest,
+		testing::ValuesIn(
+				reuseFiles
+			));
+
+
+TEST_P(ReuseTest, NoAllocationsInSteadyState)
+{
+	std::string path = "inputs/";
+	path += GetParam();
+	std::ifstream istrm(path,std::ifstream::in);
+	std::vector<uint8_t> input = get_raw_data(istrm);
+
+	MessageParser mp;
+	dns_message_value_t dm;
+	mp.Reset(input.data(), input.size());
+	mp.GetDnsMessageValue(dm);
+	dns_message_value_t expected = dm;
+
+	AllocationCounter allocations;
+	for (int i = 0; i < 100; i++)
+	{
+		mp.Reset(input.data(), input.size());
+		ASSERT_TRUE(mp.TryGetDnsMessageValue(dm));
+	}
+	EXPECT_EQ(allocations.Count(), 0u);
+
+	ASSERT_EQ(dm.Answer.size(), expected.Answer.size());
+	for (size_t i = 0; i < dm.Answer.size(); i++)
+		EXPECT_EQ(to_string(dm.Answer[i].RDATA), to_string(expected.Answer[i].RDATA));
+}
+
+
+static std::vector<std::vector<uint8_t>> read_reuse_files()
+{
+	std::vector<std::vector<uint8_t>> inputs;
+	for (const char *file : reuseFiles)
+	{
+		std::ifstream istrm(std::string("inputs/") + file, std::ifstream::in);
+		inputs.push_back(get_raw_data(istrm));
+	}
+	return inputs;
+}
+
+
+// types of records at the same position change from message to message
+TEST(Reuse, NoAllocationsCyclingInputs)
+{
+	std::vector<std::vector<uint8_t>> inputs = read_reuse_files();
+
+	MessageParser mp;
+	dns_message_value_t dm;
+	for (int round = 0; round < 5; round++)
+		for (auto &it : inputs)
+		{
+			mp.Reset(it.data(), it.size());
+			ASSERT_TRUE(mp.TryGetDnsMessageValue(dm));
+		}
+
+	AllocationCounter allocations;
+	for (int round = 0; round < 20; round++)
+		for (size_t i = 0; i < inputs.size(); i++)
+		{
+			// backwards too: another order of the same types
+			auto &it = inputs[(round % 2) ? inputs.size() - 1 - i : i];
+			mp.Reset(it.data(), it.size());
+			ASSERT_TRUE(mp.TryGetDnsMessageValue(dm));
+		}
+	EXPECT_EQ(allocations.Count(), 0u);
+}
+
+
+TEST(Reuse, SectionsShrinkAndGrow)
+{
+	std::vector<std::vector<uint8_t>> inputs = read_reuse_files();
+
+	MessageParser mp;
+	dns_message_value_t dm;
+	for (int round = 0; round < 3; round++)
+	{
+		for (auto &it : inputs)
+		{
+			mp.Reset(it.data(), it.size());
+			mp.GetDnsMessageValue(dm);
+
+			MessageParser fresh(it.data(), it.size());
+			dns_message_value_t expected = fresh.GetDnsMessageValue();
+			ASSERT_EQ(dm.Question.size(), expected.Question.size());
+			ASSERT_EQ(dm.Answer.size(), expected.Answer.size());
+			ASSERT_EQ(dm.Authority.size(), expected.Authority.size());
+			ASSERT_EQ(dm.Additional.size(), expected.Additional.size());
+			for (size_t i = 0; i < dm.Question.size(); i++)
+				EXPECT_EQ(dm.Question[i].QNAME, expected.Question[i].QNAME);
+			for (size_t i = 0; i < dm.Answer.size(); i++)
+			{
+				EXPECT_EQ(dm.Answer[i].NAME, expected.Answer[i].NAME);
+				EXPECT_EQ(to_string(dm.Answer[i].RDATA), to_string(expected.Answer[i].RDATA));
+			}
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#include "TestInputs.h"
+#include <fstream>
+#include "input.h"
+
+std::vector<uint8_t> read_input(const std::string &name)
+{
+	std::ifstream istrm("inputs/" + name, std::ifstream::in);
+	return get_raw_data(istrm);
+}
+
+const char *const wellFormedInputs[6] =
+{
+	"input", "inputQAA", "inputQAAAA", "inputQAAAd", "inputQAuthAdd", "inputQSRV"
+};
+
+const std::pair<const char *, bool> adversarialInputs[8] =
+{
+	{"adversarial/pointerLoop", false}, {"adversarial/pointerPingPong", false},
+	{"adversarial/pointerChain", false}, {"adversarial/labelPointerLoop", false},
+	{"adversarial/hugeCounts", false}, {"adversarial/manyEmptyRecords", true},
+	{"adversarial/tooLongName", false}, {"adversarial/reservedLabel", false}
+};
@@ -0,0 +1,17 @@
+#ifndef TEST_INPUTS
+#define TEST_INPUTS
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// message of inputs/<name>, in the text form dnsrrparser reads
+std::vector<uint8_t> read_input(const std::string &name);
+
+// well-formed messages of inputs/
+extern const char *const wellFormedInputs[6];
+// inputs/adversarial/ messages and whether the parser should accept them
+extern const std::pair<const char *, bool> adversarialInputs[8];
+
+#endif
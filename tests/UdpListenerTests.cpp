@@ -0,0 +1,175 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "input.h"
+#include "UdpListener.h"
+
+
+static void send_to_localhost(uint16_t port, const std::vector<uint8_t> &payload)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	ASSERT_GE(fd, 0);
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	EXPECT_EQ(sendto(fd, payload.data(), payload.size(), 0, (sockaddr*)&addr, sizeof(addr)), (ssize_t)payload.size());
+	close(fd);
+}
+
+
+TEST(UdpListener, ParsesDatagrams)
+{
+	std::ifstream istrm("inputs/inputQAAAd", std::ifstream::in);
+	std::vector<uint8_t> message = get_raw_data(istrm);
+
+	std::atomic<size_t> answers{0};
+	const size_t workers = 2;
+	const size_t buffers = 8; // less than sent, so pool is recycled
+	UdpListener listener("127.0.0.1", 0, [&](const dns_message_value_t &dm, const datagram_info_t &) {
+		answers += dm.Answer.size();
+	}, workers, buffers);
+	ASSERT_NE(listener.GetPort(), 0);
+
+	std::thread runner(&UdpListener::Run, &listener);
+
+	const size_t sent = 100;
+	for (size_t i = 0; i < sent; i++)
+		send_to_localhost(listener.GetPort(), message);
+	send_to_localhost(listener.GetPort(), {0x01, 0x02, 0x03});
+
+	const listener_stats_t &stats = listener.GetStats();
+	for (int i = 0; i < 500 && stats.Parsed + stats.Malformed < sent + 1; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	listener.Stop();
+	runner.join();
+
+	EXPECT_EQ(stats.Received, sent + 1);
+	EXPECT_EQ(stats.Parsed, sent);
+	EXPECT_EQ(stats.Malformed, 1u);
+	EXPECT_EQ(answers, sent * 3);
+}
+
+
+TEST(UdpListener, HandlerExceptionIsCounted)
+{
+	std::ifstream istrm("inputs/inputQAA", std::ifstream::in);
+	std::vector<uint8_t> message = get_raw_data(istrm);
+
+	UdpListener listener("127.0.0.1", 0, [](const dns_message_value_t &, const datagram_info_t &) {
+		throw std::runtime_error("handler failed");
+	});
+	std::thread runner(&UdpListener::Run, &listener);
+
+	const size_t sent = 3;
+	for (size_t i = 0; i < sent; i++)
+		send_to_localhost(listener.GetPort(), message);
+	const listener_stats_t &stats = listener.GetStats();
+	for (int i = 0; i < 500 && stats.HandlerFailed < sent; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	listener.Stop();
+	runner.join();
+	EXPECT_EQ(stats.Parsed, sent);
+	EXPECT_EQ(stats.HandlerFailed, sent);
+}
+
+
+TEST(UdpListener, PassesFlowAndTime)
+{
+	std::ifstream istrm("inputs/inputQAA", std::ifstream::in);
+	std::vector<uint8_t> message = get_raw_data(istrm);
+
+	std::mutex mutex;
+	std::vector<datagram_info_t> infos;
+	// destination comes from packet info when bound to any address
+	UdpListener listener("0.0.0.0", 0, [&](const dns_message_value_t &, const datagram_info_t &info) {
+		std::lock_guard<std::mutex> lock(mutex);
+		infos.push_back(info);
+	});
+	std::thread runner(&UdpListener::Run, &listener);
+
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	ASSERT_GE(fd, 0);
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(listener.GetPort());
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	uint64_t before = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	EXPECT_EQ(sendto(fd, message.data(), message.size(), 0, (sockaddr*)&addr, sizeof(addr)), (ssize_t)message.size());
+	sockaddr_in local = {};
+	socklen_t len = sizeof(local);
+	ASSERT_EQ(getsockname(fd, (sockaddr*)&local, &len), 0);
+
+	const listener_stats_t &stats = listener.GetStats();
+	for (int i = 0; i < 500 && stats.Parsed < 1; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	listener.Stop();
+	runner.join();
+	close(fd);
+	uint64_t after = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	ASSERT_EQ(infos.size(), 1u);
+	const std::array<uint8_t, 16> loopback = {127, 0, 0, 1};
+	EXPECT_EQ(infos[0].Flow.SrcAddress, loopback);
+	EXPECT_EQ(infos[0].Flow.SrcPort, ntohs(local.sin_port));
+	EXPECT_EQ(infos[0].Flow.DstAddress, loopback);
+	EXPECT_EQ(infos[0].Flow.DstPort, listener.GetPort());
+	EXPECT_GE(infos[0].Time, before);
+	EXPECT_LE(infos[0].Time, after);
+}
+
+
+TEST(UdpListener, StopsUnderLoad)
+{
+	std::ifstream istrm("inputs/inputQAA", std::ifstream::in);
+	std::vector<uint8_t> message = get_raw_data(istrm);
+
+	UdpListener listener("127.0.0.1", 0, [](const dns_message_value_t &, const datagram_info_t &) {});
+	std::thread runner(&UdpListener::Run, &listener);
+
+	// socket is never drained while sender runs
+	std::atomic<bool> sending{true};
+	std::thread sender([&] {
+		int fd = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(listener.GetPort());
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		while (sending)
+			sendto(fd, message.data(), message.size(), 0, (sockaddr*)&addr, sizeof(addr));
+		close(fd);
+	});
+
+	const listener_stats_t &stats = listener.GetStats();
+	for (int i = 0; i < 500 && stats.Received < 1000; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	listener.Stop();
+	runner.join();
+	sending = false;
+	sender.join();
+	EXPECT_GE(stats.Received, 1000u);
+}
+
+
+TEST(UdpListener, StopBeforeRun)
+{
+	UdpListener listener("127.0.0.1", 0, [](const dns_message_value_t &, const datagram_info_t &) {});
+	listener.Stop();
+	listener.Run();
+}
+
+
+TEST(UdpListener, WrongAddress)
+{
+	EXPECT_THROW(UdpListener("not an address", 0, [](const dns_message_value_t &, const datagram_info_t &) {}), std::invalid_argument);
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "ZoneTransfer.h"
+#include "dns_constants.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+static resource_record_value_t make_soa(uint32_t serial)
+{
+	soa_rdata_t soa = {"ns.example.com.", "noc.example.com.", serial, 3600, 1200, 604800, 60};
+	return {"example.com.", TYPE_SOA, 1, 3600, soa};
+}
+
+static resource_record_value_t make_a(uint8_t last)
+{
+	a_rdata_t a = {{192, 0, 2, last}};
+	return {"host" + std::to_string(last) + ".example.com.", TYPE_A, 1, 300, a};
+}
+
+// TCP stream: every message is prefixed with length
+static void append_message(std::vector<uint8_t> &stream, const std::vector<resource_record_value_t> &records, bool withQuestion)
+{
+	std::vector<uint8_t> message = {0x12, 0x34, 0x84, 0x00, 0x00, (uint8_t)withQuestion, 0x00, (uint8_t)records.size(), 0, 0, 0, 0};
+	if (withQuestion)
+	{
+		append_wire_name(message, "example.com.");
+		message.insert(message.end(), {0x00, 0xfc, 0x00, 0x01});
+	}
+	for (const auto &it : records)
+		append_wire_record(message, it);
+	stream.push_back(message.size() >> 8);
+	stream.push_back(message.size() & 0xff);
+	stream.insert(stream.end(), message.begin(), message.end());
+}
+
+struct collected_t {
+	std::vector<std::string> added;
+	std::vector<std::string> deleted;
+};
+
+static ZoneTransferParser::Handler collect(collected_t &c)
+{
+	return [&c](const resource_record_value_t &rr, bool deleted) {
+		(deleted ? c.deleted : c.added).push_back(rr.NAME + " " + to_string(rr.RDATA));
+	};
+}
+
+
+TEST(ZoneTransfer, AxfrInChunks)
+{
+	std::vector<uint8_t> stream;
+	append_message(stream, {make_soa(7), make_a(1), make_a(2)}, true);
+	for (uint8_t i = 3; i < 200; i += 3)
+		append_message(stream, {make_a(i), make_a(i + 1), make_a(i + 2)}, false);
+	append_message(stream, {make_a(201), make_soa(7)}, false);
+
+	// every chunk size splits frames differently
+	for (size_t chunk : {1, 2, 3, 7, 100, 65536})
+	{
+		collected_t c;
+		ZoneTransferParser parser(collect(c));
+		for (size_t offset = 0; offset < stream.size(); offset += chunk)
+			parser.Feed(stream.data() + offset, std::min(chunk, stream.size() - offset));
+
+		EXPECT_TRUE(parser.IsComplete());
+		EXPECT_FALSE(parser.IsIncremental());
+		EXPECT_EQ(parser.GetSerial(), 7u);
+		ASSERT_EQ(c.added.size(), 1 + 2 + 198 + 1u);
+		EXPECT_TRUE(c.deleted.empty());
+		EXPECT_EQ(c.added[0], "example.com. ns.example.com. noc.example.com. 7 3600 1200 604800 60");
+		EXPECT_EQ(c.added[1], "host1.example.com. 192.0.2.1");
+		EXPECT_EQ(c.added.back(), "host201.example.com. 192.0.2.201");
+	}
+}
+
+
+TEST(ZoneTransfer, Ixfr)
+{
+	std::vector<uint8_t> stream;
+	// 5 -> 6: delete host1, add host2; 6 -> 7: add host3
+	append_message(stream, {make_soa(7), make_soa(5), make_a(1), make_soa(6), make_a(2)}, true);
+	append_message(stream, {make_soa(6), make_soa(7), make_a(3), make_soa(7)}, false);
+
+	collected_t c;
+	ZoneTransferParser parser(collect(c));
+	parser.Feed(stream.data(), stream.size());
+
+	EXPECT_TRUE(parser.IsComplete());
+	EXPECT_TRUE(parser.IsIncremental());
+	ASSERT_EQ(c.deleted.size(), 3u);
+	EXPECT_EQ(c.deleted[1], "host1.example.com. 192.0.2.1");
+	ASSERT_EQ(c.added.size(), 4u);
+	EXPECT_EQ(c.added[1], "host2.example.com. 192.0.2.2");
+	EXPECT_EQ(c.added[3], "host3.example.com. 192.0.2.3");
+}
+
+
+TEST(ZoneTransfer, Errors)
+{
+	collected_t c;
+	std::vector<uint8_t> stream;
+	append_message(stream, {make_a(1), make_soa(1)}, true);
+	ZoneTransferParser notSoa(collect(c));
+	EXPECT_THROW(notSoa.Feed(stream.data(), stream.size()), std::invalid_argument);
+
+	stream.clear();
+	append_message(stream, {make_soa(1), make_soa(1), make_a(1)}, true);
+	ZoneTransferParser afterEnd(collect(c));
+	EXPECT_THROW(afterEnd.Feed(stream.data(), stream.size()), std::invalid_argument);
+
+	stream.clear();
+	append_message(stream, {make_soa(1), make_a(1)}, true);
+	stream[5] |= 0x05; // REFUSED
+	ZoneTransferParser refused(collect(c));
+	EXPECT_THROW(refused.Feed(stream.data(), stream.size()), std::invalid_argument);
+}
+
+
+TEST(ZoneTransfer, WireRoundTrip)
+{
+	std::vector<resource_record_value_t> records = {make_soa(1), make_a(1)};
+	records.push_back({"mail.example.com.", TYPE_MX, 1, 60, mx_rdata_t{10, "mx.example.com."}});
+	records.push_back({"_sip._udp.example.com.", TYPE_SRV, 1, 60, srv_rdata_t{1, 2, 5060, "sip.example.com."}});
+	records.push_back({"example.com.", 99, 1, 60, generic_rdata_t((const uint8_t*)"abc", 3)});
+	std::vector<uint8_t> stream;
+	append_message(stream, records, false);
+
+	MessageParser mp(stream.data() + 2, stream.size() - 2);
+	dns_message_value_t dm = mp.GetDnsMessageValue();
+	ASSERT_EQ(dm.Answer.size(), records.size());
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		EXPECT_EQ(dm.Answer[i].NAME, records[i].NAME);
+		EXPECT_EQ(to_string(dm.Answer[i].RDATA), to_string(records[i].RDATA));
+	}
+
+	std::stringstream text;
+	write_zone_text(text, records[1], true);
+	EXPECT_EQ(text.str(), "; delete host1.example.com.\t\t300\tIN\tA\t192.0.2.1\n");
+}
+
+
+TEST(ZoneTransfer, MasterFileText)
+{
+	std::stringstream text;
+	std::string txt("\x05hello\x07" "a \"b\"\\\x01", 14);
+	write_zone_text(text, {"example.com.", TYPE_TXT, 1, 60, txt_rdata_t{txt}}, false);
+	EXPECT_EQ(text.str(), "example.com.\t\t60\tIN\tTXT\t\"hello\" \"a \\\"b\\\"\\\\\\001\"\n");
+
+	text.str("");
+	write_zone_text(text, {"example.com.", TYPE_TXT, 1, 60, txt_rdata_t{"\x05" "cut"}}, false);
+	EXPECT_EQ(text.str(), "example.com.\t\t60\tIN\tTXT\t\\# 4 05637574\n");
+
+	text.str("");
+	write_zone_text(text, {"example.com.", 65280, 7, 60, generic_rdata_t((const uint8_t*)"\xab\x01", 2)}, false);
+	EXPECT_EQ(text.str(), "example.com.\t\t60\tCLASS7\tTYPE65280\t\\# 2 ab01\n");
+
+	text.str("");
+	write_zone_text(text, {"example.com.", 99, 1, 60, generic_rdata_t()}, false);
+	EXPECT_EQ(text.str(), "example.com.\t\t60\tIN\tTYPE99\t\\# 0\n");
+}
+
+
+TEST(ZoneTransfer, MasterFileNames)
+{
+	// root owner and null MX (rfc-7505)
+	std::stringstream text;
+	write_zone_text(text, {"", TYPE_MX, 1, 60, mx_rdata_t{0, ""}}, false);
+	EXPECT_EQ(text.str(), ".\t\t60\tIN\tMX\t0 .\n");
+
+	text.str("");
+	std::string owner("a b;c(d)\"e\\f@$\x01\xff.example.com.");
+	write_zone_text(text, {owner, TYPE_CNAME, 1, 60, domain_rdata_t{"example.com"}}, false);
+	EXPECT_EQ(text.str(), "a\\ b\\;c\\(d\\)\\\"e\\\\f\\@\\$\\001\\255.example.com.\t\t60\tIN\tCNAME\texample.com.\n");
+
+	text.str("");
+	soa_rdata_t soa = {"", "host\\master.example.com.", 1, 2, 3, 4, 5};
+	write_zone_text(text, {"example.com.", TYPE_SOA, 1, 60, soa}, false);
+	EXPECT_EQ(text.str(), "example.com.\t\t60\tIN\tSOA\t. host\\\\master.example.com. 1 2 3 4 5\n");
+
+	text.str("");
+	write_zone_text(text, {"_sip._udp.example.com.", TYPE_SRV, 1, 60, srv_rdata_t{1, 2, 5060, ""}}, false);
+	EXPECT_EQ(text.str(), "_sip._udp.example.com.\t\t60\tIN\tSRV\t1 2 5060 .\n");
+}